@@ -24,6 +24,8 @@
 #include "meta-cursor-private.h"
 
 #include <meta/errors.h>
+#include <meta/main.h>
+#include <meta/util.h>
 
 #include "display-private.h"
 #include "screen-private.h"
@@ -43,6 +45,37 @@
 #include <cogl/cogl-wayland-server.h>
 #endif
 
+/* Theme cursors only depend on the cursor theme and size, so one
+ * reference per cursor is shared process wide, keeping its decoded
+ * image and uploaded texture/buffer around until the theme changes.
+ */
+typedef struct {
+  char *theme;
+  int size;
+  MetaCursorReference *cursors[META_CURSOR_LAST];
+  guint preload_id;
+} MetaThemeCursorCache;
+
+static MetaThemeCursorCache theme_cursor_cache;
+
+/* Cursors likely to be shown soon after startup or a theme change */
+static const MetaCursor preloaded_cursors[] = {
+  META_CURSOR_DEFAULT,
+  META_CURSOR_IBEAM,
+  META_CURSOR_POINTING_HAND,
+  META_CURSOR_NORTH_RESIZE,
+  META_CURSOR_SOUTH_RESIZE,
+  META_CURSOR_WEST_RESIZE,
+  META_CURSOR_EAST_RESIZE,
+  META_CURSOR_SE_RESIZE,
+  META_CURSOR_SW_RESIZE,
+  META_CURSOR_NE_RESIZE,
+  META_CURSOR_NW_RESIZE,
+  META_CURSOR_MOVE_OR_RESIZE_WINDOW,
+};
+
+static void load_cursor_image (MetaCursorReference *cursor);
+
 MetaCursorReference *
 meta_cursor_reference_ref (MetaCursorReference *self)
 {
@@ -274,13 +307,84 @@ load_cursor_image (MetaCursorReference *cursor)
   XcursorImageDestroy (image);
 }
 
+static MetaCursorReference *
+get_cached_theme_cursor (MetaCursor cursor)
+{
+  MetaCursorReference *self = theme_cursor_cache.cursors[cursor];
+
+  if (!self)
+    {
+      self = g_slice_new0 (MetaCursorReference);
+      self->ref_count = 1;
+      self->cursor = cursor;
+      theme_cursor_cache.cursors[cursor] = self;
+    }
+
+  return self;
+}
+
+static gboolean
+preload_theme_cursors (gpointer user_data)
+{
+  gint64 start_time = g_get_monotonic_time ();
+  unsigned int i;
+
+  for (i = 0; i < G_N_ELEMENTS (preloaded_cursors); i++)
+    {
+      MetaCursorReference *self = get_cached_theme_cursor (preloaded_cursors[i]);
+
+      if (!self->image.texture)
+        load_cursor_image (self);
+    }
+
+  meta_topic (META_DEBUG_THEMES,
+              "Preloaded %u cursors from theme %s in %" G_GINT64_FORMAT " us\n",
+              (unsigned int) G_N_ELEMENTS (preloaded_cursors),
+              theme_cursor_cache.theme ? theme_cursor_cache.theme : "(default)",
+              g_get_monotonic_time () - start_time);
+
+  theme_cursor_cache.preload_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+ensure_theme_cursor_cache (void)
+{
+  const char *theme = meta_prefs_get_cursor_theme ();
+  int size = meta_prefs_get_cursor_size ();
+  unsigned int i;
+
+  if (theme_cursor_cache.size == size &&
+      g_strcmp0 (theme_cursor_cache.theme, theme) == 0)
+    return;
+
+  meta_topic (META_DEBUG_THEMES,
+              "Dropping cached cursors, theme is now %s at size %d\n",
+              theme ? theme : "(default)", size);
+
+  /* References still held elsewhere stay valid until released */
+  for (i = 0; i < META_CURSOR_LAST; i++)
+    g_clear_pointer (&theme_cursor_cache.cursors[i], meta_cursor_reference_unref);
+
+  g_free (theme_cursor_cache.theme);
+  theme_cursor_cache.theme = g_strdup (theme);
+  theme_cursor_cache.size = size;
+
+  /* Cursor images are only drawn by us when running as a Wayland
+   * compositor; otherwise the X server draws them from X cursors. */
+  if (meta_is_wayland_compositor () && theme_cursor_cache.preload_id == 0)
+    theme_cursor_cache.preload_id = g_idle_add (preload_theme_cursors, NULL);
+}
+
 MetaCursorReference *
 meta_cursor_reference_from_theme (MetaCursor cursor)
 {
-  MetaCursorReference *self = g_slice_new0 (MetaCursorReference);
-  self->ref_count = 1;
-  self->cursor = cursor;
-  return self;
+  g_return_val_if_fail (cursor > META_CURSOR_NONE &&
+                        cursor < META_CURSOR_LAST, NULL);
+
+  ensure_theme_cursor_cache ();
+
+  return meta_cursor_reference_ref (get_cached_theme_cursor (cursor));
 }
 
 #ifdef HAVE_WAYLAND
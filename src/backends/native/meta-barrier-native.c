@@ -42,7 +42,14 @@
 
 struct _MetaBarrierManagerNative
 {
-  GHashTable *barriers;
+  /* Horizontal barriers sorted by y and vertical barriers sorted by x,
+   * so that a motion only needs to look at the barriers within the
+   * range its segment spans. */
+  GArray *horizontal_barriers;
+  GArray *vertical_barriers;
+
+  /* Barriers that are not in the ACTIVE state */
+  GHashTable *engaged_barriers;
 };
 
 typedef enum {
@@ -215,13 +222,134 @@ is_barrier_blocking_directions (MetaBarrier         *barrier,
   return (barrier->priv->directions & directions) != directions;
 }
 
+static void
+set_barrier_state (MetaBarrierImplNative *self,
+                   MetaBarrierState       state)
+{
+  MetaBarrierImplNativePrivate *priv =
+    meta_barrier_impl_native_get_instance_private (self);
+
+  priv->state = state;
+
+  if (!priv->is_active)
+    return;
+
+  if (state == META_BARRIER_STATE_ACTIVE)
+    g_hash_table_remove (priv->manager->engaged_barriers, self);
+  else
+    g_hash_table_add (priv->manager->engaged_barriers, self);
+}
+
 static void
 dismiss_pointer (MetaBarrierImplNative *self)
+{
+  set_barrier_state (self, META_BARRIER_STATE_LEFT);
+}
+
+static int
+get_barrier_position (MetaBarrier *barrier)
+{
+  if (is_barrier_horizontal (barrier))
+    return barrier->priv->y1;
+  else
+    return barrier->priv->x1;
+}
+
+static GArray *
+get_barrier_index (MetaBarrierManagerNative *manager,
+                   MetaBarrier              *barrier)
+{
+  if (is_barrier_horizontal (barrier))
+    return manager->horizontal_barriers;
+  else
+    return manager->vertical_barriers;
+}
+
+static MetaBarrierImplNative *
+get_indexed_barrier (GArray *barriers,
+                     guint   i)
+{
+  return g_array_index (barriers, MetaBarrierImplNative *, i);
+}
+
+static int
+get_indexed_barrier_position (GArray *barriers,
+                              guint   i)
+{
+  MetaBarrierImplNative *self = get_indexed_barrier (barriers, i);
+  MetaBarrierImplNativePrivate *priv =
+    meta_barrier_impl_native_get_instance_private (self);
+
+  return get_barrier_position (priv->barrier);
+}
+
+/* Returns the index of the first barrier positioned at or after
+ * @position. */
+static guint
+find_indexed_barrier (GArray *barriers,
+                      float   position)
+{
+  guint low = 0, high = barriers->len;
+
+  while (low < high)
+    {
+      guint mid = low + (high - low) / 2;
+
+      if (get_indexed_barrier_position (barriers, mid) < position)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+static void
+index_barrier (MetaBarrierManagerNative *manager,
+               MetaBarrierImplNative    *self)
 {
   MetaBarrierImplNativePrivate *priv =
     meta_barrier_impl_native_get_instance_private (self);
+  GArray *barriers = get_barrier_index (manager, priv->barrier);
+  int position = get_barrier_position (priv->barrier);
+  guint i;
 
-  priv->state = META_BARRIER_STATE_LEFT;
+  i = find_indexed_barrier (barriers, position);
+  g_array_insert_val (barriers, i, self);
+}
+
+static void
+unindex_barrier (MetaBarrierManagerNative *manager,
+                 MetaBarrierImplNative    *self)
+{
+  MetaBarrierImplNativePrivate *priv =
+    meta_barrier_impl_native_get_instance_private (self);
+  GArray *barriers = get_barrier_index (manager, priv->barrier);
+  int position = get_barrier_position (priv->barrier);
+  guint i;
+
+  for (i = find_indexed_barrier (barriers, position); i < barriers->len; i++)
+    {
+      if (get_indexed_barrier (barriers, i) == self)
+        {
+          g_array_remove_index (barriers, i);
+          return;
+        }
+    }
+}
+
+/* Returns the engaged barriers, referenced, since handling them may
+ * emit signals which could destroy barriers. */
+static GList *
+get_engaged_barriers (MetaBarrierManagerNative *manager)
+{
+  GList *barriers, *l;
+
+  barriers = g_hash_table_get_keys (manager->engaged_barriers);
+  for (l = barriers; l; l = l->next)
+    g_object_ref (l->data);
+
+  return barriers;
 }
 
 static Line2
@@ -280,17 +408,18 @@ is_within_box (Line2 box, Vector2 point)
 }
 
 static void
-maybe_release_barrier (gpointer key,
-                       gpointer value,
-                       gpointer user_data)
+maybe_release_barrier (MetaBarrierImplNative *self,
+                       Line2                 *motion)
 {
-  MetaBarrierImplNative *self = key;
   MetaBarrierImplNativePrivate *priv =
     meta_barrier_impl_native_get_instance_private (self);
   MetaBarrier *barrier = priv->barrier;
-  Line2 *motion = user_data;
   Line2 hit_box;
 
+  /* Destroyed while handling a previous barrier */
+  if (!priv->is_active)
+    return;
+
   if (priv->state != META_BARRIER_STATE_HELD)
     return;
 
@@ -330,6 +459,7 @@ maybe_release_barriers (MetaBarrierManagerNative *manager,
                         float                     x,
                         float                     y)
 {
+  GList *barriers, *l;
   Line2 motion = {
     .a = {
       .x = prev_x,
@@ -341,9 +471,10 @@ maybe_release_barriers (MetaBarrierManagerNative *manager,
     },
   };
 
-  g_hash_table_foreach (manager->barriers,
-                        maybe_release_barrier,
-                        &motion);
+  barriers = get_engaged_barriers (manager);
+  for (l = barriers; l; l = l->next)
+    maybe_release_barrier (l->data, &motion);
+  g_list_free_full (barriers, g_object_unref);
 }
 
 typedef struct _MetaClosestBarrierData
@@ -362,15 +493,12 @@ typedef struct _MetaClosestBarrierData
 } MetaClosestBarrierData;
 
 static void
-update_closest_barrier (gpointer key,
-                        gpointer value,
-                        gpointer user_data)
+update_closest_barrier (MetaBarrierImplNative  *self,
+                        MetaClosestBarrierData *data)
 {
-  MetaBarrierImplNative *self = key;
   MetaBarrierImplNativePrivate *priv =
     meta_barrier_impl_native_get_instance_private (self);
   MetaBarrier *barrier = priv->barrier;
-  MetaClosestBarrierData *data = user_data;
   Line2 barrier_line;
   Vector2 intersection;
   float dx, dy;
@@ -427,6 +555,7 @@ get_closest_barrier (MetaBarrierManagerNative *manager,
                      MetaBarrierImplNative   **barrier_impl)
 {
   MetaClosestBarrierData closest_barrier_data;
+  guint i;
 
   closest_barrier_data = (MetaClosestBarrierData) {
     .in = {
@@ -444,9 +573,20 @@ get_closest_barrier (MetaBarrierManagerNative *manager,
     },
   };
 
-  g_hash_table_foreach (manager->barriers,
-                        update_closest_barrier,
-                        &closest_barrier_data);
+  /* Only barriers within the span of the motion can intersect it */
+  for (i = find_indexed_barrier (manager->horizontal_barriers, MIN (prev_y, y));
+       i < manager->horizontal_barriers->len &&
+       get_indexed_barrier_position (manager->horizontal_barriers, i) <= MAX (prev_y, y);
+       i++)
+    update_closest_barrier (get_indexed_barrier (manager->horizontal_barriers, i),
+                            &closest_barrier_data);
+
+  for (i = find_indexed_barrier (manager->vertical_barriers, MIN (prev_x, x));
+       i < manager->vertical_barriers->len &&
+       get_indexed_barrier_position (manager->vertical_barriers, i) <= MAX (prev_x, x);
+       i++)
+    update_closest_barrier (get_indexed_barrier (manager->vertical_barriers, i),
+                            &closest_barrier_data);
 
   if (closest_barrier_data.out.barrier_impl != NULL)
     {
@@ -489,14 +629,14 @@ emit_barrier_event (MetaBarrierImplNative *self,
   switch (priv->state)
     {
     case META_BARRIER_STATE_HIT:
-      priv->state = META_BARRIER_STATE_HELD;
+      set_barrier_state (self, META_BARRIER_STATE_HELD);
       priv->trigger_serial = next_serial ();
       event->dt = 0;
 
       break;
     case META_BARRIER_STATE_RELEASE:
     case META_BARRIER_STATE_LEFT:
-      priv->state = META_BARRIER_STATE_ACTIVE;
+      set_barrier_state (self, META_BARRIER_STATE_ACTIVE);
 
       /* Intentional fall-through. */
     case META_BARRIER_STATE_HELD:
@@ -530,12 +670,14 @@ emit_barrier_event (MetaBarrierImplNative *self,
 }
 
 static void
-maybe_emit_barrier_event (gpointer key, gpointer value, gpointer user_data)
+maybe_emit_barrier_event (MetaBarrierImplNative *self,
+                          MetaBarrierEventData  *data)
 {
-  MetaBarrierImplNative *self = key;
   MetaBarrierImplNativePrivate *priv =
     meta_barrier_impl_native_get_instance_private (self);
-  MetaBarrierEventData *data = user_data;
+
+  if (!priv->is_active)
+    return;
 
   switch (priv->state) {
     case META_BARRIER_STATE_ACTIVE:
@@ -592,7 +734,7 @@ clamp_to_barrier (MetaBarrierImplNative *self,
                        META_BARRIER_DIRECTION_NEGATIVE_X);
     }
 
-  priv->state = META_BARRIER_STATE_HIT;
+  set_barrier_state (self, META_BARRIER_STATE_HIT);
 }
 
 void
@@ -610,6 +752,7 @@ meta_barrier_manager_native_process (MetaBarrierManagerNative *manager,
   MetaBarrierDirection motion_dir = 0;
   MetaBarrierEventData barrier_event_data;
   MetaBarrierImplNative *barrier_impl;
+  GList *barriers, *l;
 
   if (!clutter_input_device_get_coords (device, NULL, &prev_pos))
     return;
@@ -641,6 +784,10 @@ meta_barrier_manager_native_process (MetaBarrierManagerNative *manager,
         break;
     }
 
+  /* Only barriers being hit, held or just left need further processing. */
+  if (g_hash_table_size (manager->engaged_barriers) == 0)
+    return;
+
   /* Potentially release active barrier movements. */
   maybe_release_barriers (manager, prev_x, prev_y, *x, *y);
 
@@ -655,9 +802,10 @@ meta_barrier_manager_native_process (MetaBarrierManagerNative *manager,
     .dy = orig_y - prev_y,
   };
 
-  g_hash_table_foreach (manager->barriers,
-                        maybe_emit_barrier_event,
-                        &barrier_event_data);
+  barriers = get_engaged_barriers (manager);
+  for (l = barriers; l; l = l->next)
+    maybe_emit_barrier_event (l->data, &barrier_event_data);
+  g_list_free_full (barriers, g_object_unref);
 }
 
 static gboolean
@@ -680,7 +828,7 @@ _meta_barrier_impl_native_release (MetaBarrierImpl  *impl,
 
   if (priv->state == META_BARRIER_STATE_HELD &&
       event->event_id == priv->trigger_serial)
-    priv->state = META_BARRIER_STATE_RELEASE;
+    set_barrier_state (self, META_BARRIER_STATE_RELEASE);
 }
 
 static void
@@ -690,7 +838,11 @@ _meta_barrier_impl_native_destroy (MetaBarrierImpl *impl)
   MetaBarrierImplNativePrivate *priv =
     meta_barrier_impl_native_get_instance_private (self);
 
-  g_hash_table_remove (priv->manager->barriers, self);
+  if (!priv->is_active)
+    return;
+
+  unindex_barrier (priv->manager, self);
+  g_hash_table_remove (priv->manager->engaged_barriers, self);
   priv->is_active = FALSE;
 }
 
@@ -711,7 +863,7 @@ meta_barrier_impl_native_new (MetaBarrier *barrier)
   native = META_BACKEND_NATIVE (meta_get_backend ());
   manager = meta_backend_native_get_barrier_manager (native);
   priv->manager = manager;
-  g_hash_table_add (manager->barriers, self);
+  index_barrier (manager, self);
 
   return META_BARRIER_IMPL (self);
 }
@@ -738,7 +890,11 @@ meta_barrier_manager_native_new (void)
 
   manager = g_new0 (MetaBarrierManagerNative, 1);
 
-  manager->barriers = g_hash_table_new (NULL, NULL);
+  manager->horizontal_barriers = g_array_new (FALSE, FALSE,
+                                              sizeof (MetaBarrierImplNative *));
+  manager->vertical_barriers = g_array_new (FALSE, FALSE,
+                                            sizeof (MetaBarrierImplNative *));
+  manager->engaged_barriers = g_hash_table_new (NULL, NULL);
 
   return manager;
 }
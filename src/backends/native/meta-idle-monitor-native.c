@@ -35,6 +35,18 @@ struct _MetaIdleMonitorNative
   MetaIdleMonitor parent;
 
   guint64 last_event_time;
+
+  /* Idle watches sorted by timeout; since all of them count from the
+   * same last event time, resetting the idle time doesn't change their
+   * order, and a single source armed for the first watch that didn't
+   * fire yet is enough to serve them all. */
+  GSequence *idle_watches;
+  GSequenceIter *next_watch;
+  GSource *timeout_source;
+  guint reset_serial;
+
+  /* User active watches (timeout 0), fired on the next event */
+  GList *user_active_watches;
 };
 
 struct _MetaIdleMonitorNativeClass
@@ -45,7 +57,8 @@ struct _MetaIdleMonitorNativeClass
 typedef struct {
   MetaIdleMonitorWatch base;
 
-  GSource *timeout_source;
+  GSequenceIter *iter;
+  guint fired_serial;
 } MetaIdleMonitorWatchNative;
 
 G_DEFINE_TYPE (MetaIdleMonitorNative, meta_idle_monitor_native, META_TYPE_IDLE_MONITOR)
@@ -66,16 +79,79 @@ get_next_watch_serial (void)
   return serial;
 }
 
+static gint
+compare_watches (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+  const MetaIdleMonitorWatch *watch_a = a;
+  const MetaIdleMonitorWatch *watch_b = b;
+
+  if (watch_a->timeout_msec != watch_b->timeout_msec)
+    return watch_a->timeout_msec < watch_b->timeout_msec ? -1 : 1;
+  if (watch_a->id != watch_b->id)
+    return watch_a->id < watch_b->id ? -1 : 1;
+
+  return 0;
+}
+
+static gint64
+get_watch_deadline (MetaIdleMonitorNative *monitor_native,
+                    MetaIdleMonitorWatch  *watch)
+{
+  return monitor_native->last_event_time + watch->timeout_msec * 1000;
+}
+
+static void
+arm_timeout_source (MetaIdleMonitorNative *monitor_native)
+{
+  MetaIdleMonitorWatch *watch;
+
+  if (monitor_native->next_watch == NULL ||
+      g_sequence_iter_is_end (monitor_native->next_watch))
+    {
+      g_source_set_ready_time (monitor_native->timeout_source, -1);
+      return;
+    }
+
+  watch = g_sequence_get (monitor_native->next_watch);
+  g_source_set_ready_time (monitor_native->timeout_source,
+                           get_watch_deadline (monitor_native, watch));
+}
+
 static gboolean
 native_dispatch_timeout (GSource     *source,
                          GSourceFunc  callback,
                          gpointer     user_data)
 {
-  MetaIdleMonitorWatchNative *watch_native = user_data;
-  MetaIdleMonitorWatch *watch = (MetaIdleMonitorWatch *) watch_native;
+  MetaIdleMonitorNative *monitor_native = user_data;
+  gint64 now = g_source_get_time (source);
+
+  g_object_ref (monitor_native);
+
+  while (monitor_native->next_watch != NULL &&
+         !g_sequence_iter_is_end (monitor_native->next_watch))
+    {
+      MetaIdleMonitorWatchNative *watch_native = g_sequence_get (monitor_native->next_watch);
+      MetaIdleMonitorWatch *watch = (MetaIdleMonitorWatch *) watch_native;
+
+      if (get_watch_deadline (monitor_native, watch) > now)
+        break;
+
+      /* Advance first, the callback may remove the watch */
+      monitor_native->next_watch = g_sequence_iter_next (monitor_native->next_watch);
+
+      if (watch_native->fired_serial != monitor_native->reset_serial)
+        {
+          watch_native->fired_serial = monitor_native->reset_serial;
+          _meta_idle_monitor_watch_fire (watch);
+        }
+    }
+
+  arm_timeout_source (monitor_native);
+
+  g_object_unref (monitor_native);
 
-  _meta_idle_monitor_watch_fire (watch);
-  g_source_set_ready_time (watch_native->timeout_source, -1);
   return TRUE;
 }
 
@@ -92,6 +168,7 @@ free_watch (gpointer data)
   MetaIdleMonitorWatchNative *watch_native = data;
   MetaIdleMonitorWatch *watch = (MetaIdleMonitorWatch *) watch_native;
   MetaIdleMonitor *monitor = watch->monitor;
+  MetaIdleMonitorNative *monitor_native = META_IDLE_MONITOR_NATIVE (monitor);
 
   g_object_ref (monitor);
 
@@ -104,8 +181,24 @@ free_watch (gpointer data)
   if (watch->notify != NULL)
     watch->notify (watch->user_data);
 
-  if (watch_native->timeout_source != NULL)
-    g_source_destroy (watch_native->timeout_source);
+  if (watch_native->iter != NULL)
+    {
+      if (monitor_native->next_watch == watch_native->iter)
+        {
+          monitor_native->next_watch = g_sequence_iter_next (watch_native->iter);
+          g_sequence_remove (watch_native->iter);
+          arm_timeout_source (monitor_native);
+        }
+      else
+        {
+          g_sequence_remove (watch_native->iter);
+        }
+    }
+  else
+    {
+      monitor_native->user_active_watches =
+        g_list_remove (monitor_native->user_active_watches, watch_native);
+    }
 
   g_object_unref (monitor);
   g_slice_free (MetaIdleMonitorWatchNative, watch_native);
@@ -134,24 +227,58 @@ meta_idle_monitor_native_make_watch (MetaIdleMonitor           *monitor,
 
   if (timeout_msec != 0)
     {
-      GSource *source = g_source_new (&native_source_funcs, sizeof (GSource));
+      watch_native->fired_serial = monitor_native->reset_serial - 1;
+      watch_native->iter = g_sequence_insert_sorted (monitor_native->idle_watches,
+                                                     watch_native,
+                                                     compare_watches, NULL);
+
+      /* Watches before the next one already fired in this idle period;
+       * a new watch sorting before it is overdue and becomes the next
+       * one, the dispatch skips over those that already fired. */
+      if (monitor_native->next_watch == NULL ||
+          g_sequence_iter_is_end (monitor_native->next_watch) ||
+          g_sequence_iter_compare (watch_native->iter, monitor_native->next_watch) < 0)
+        {
+          monitor_native->next_watch = watch_native->iter;
+          arm_timeout_source (monitor_native);
+        }
+    }
+  else
+    {
+      monitor_native->user_active_watches =
+        g_list_prepend (monitor_native->user_active_watches, watch_native);
+    }
 
-      g_source_set_callback (source, NULL, watch, NULL);
-      g_source_set_ready_time (source, monitor_native->last_event_time + timeout_msec * 1000);
-      g_source_attach (source, NULL);
-      g_source_unref (source);
+  return watch;
+}
+
+static void
+meta_idle_monitor_native_dispose (GObject *object)
+{
+  MetaIdleMonitorNative *monitor_native = META_IDLE_MONITOR_NATIVE (object);
 
-      watch_native->timeout_source = source;
+  /* Frees the watches, which unlink themselves from the sequence */
+  G_OBJECT_CLASS (meta_idle_monitor_native_parent_class)->dispose (object);
+
+  if (monitor_native->timeout_source != NULL)
+    {
+      g_source_destroy (monitor_native->timeout_source);
+      g_source_unref (monitor_native->timeout_source);
+      monitor_native->timeout_source = NULL;
     }
 
-  return watch;
+  monitor_native->next_watch = NULL;
+  g_clear_pointer (&monitor_native->idle_watches, g_sequence_free);
 }
 
 static void
 meta_idle_monitor_native_class_init (MetaIdleMonitorNativeClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   MetaIdleMonitorClass *idle_monitor_class = META_IDLE_MONITOR_CLASS (klass);
 
+  object_class->dispose = meta_idle_monitor_native_dispose;
+
   idle_monitor_class->get_idletime = meta_idle_monitor_native_get_idletime;
   idle_monitor_class->make_watch = meta_idle_monitor_native_make_watch;
 }
@@ -160,60 +287,55 @@ static void
 meta_idle_monitor_native_init (MetaIdleMonitorNative *monitor_native)
 {
   MetaIdleMonitor *monitor = META_IDLE_MONITOR (monitor_native);
+  GSource *source;
 
   monitor->watches = g_hash_table_new_full (NULL, NULL, NULL, free_watch);
-}
 
-typedef struct {
-  MetaIdleMonitorNative *monitor_native;
-  GList *fired_watches;
-} CheckNativeClosure;
+  monitor_native->idle_watches = g_sequence_new (NULL);
+  monitor_native->next_watch = g_sequence_get_begin_iter (monitor_native->idle_watches);
+  monitor_native->reset_serial = 1;
 
-static gboolean
-check_native_watch (gpointer key,
-                    gpointer value,
-                    gpointer user_data)
-{
-  MetaIdleMonitorWatchNative *watch_native = value;
-  MetaIdleMonitorWatch *watch = (MetaIdleMonitorWatch *) watch_native;
-  CheckNativeClosure *closure = user_data;
-  gboolean steal;
+  source = g_source_new (&native_source_funcs, sizeof (GSource));
+  g_source_set_callback (source, NULL, monitor_native, NULL);
+  g_source_set_ready_time (source, -1);
+  g_source_set_name (source, "[mutter] idle monitor");
+  g_source_attach (source, NULL);
 
-  if (watch->timeout_msec == 0)
-    {
-      closure->fired_watches = g_list_prepend (closure->fired_watches, watch);
-      steal = TRUE;
-    }
-  else
-    {
-      g_source_set_ready_time (watch_native->timeout_source,
-                               closure->monitor_native->last_event_time +
-                               watch->timeout_msec * 1000);
-      steal = FALSE;
-    }
-
-  return steal;
-}
-
-static void
-fire_native_watch (gpointer watch,
-                   gpointer data)
-{
-  _meta_idle_monitor_watch_fire (watch);
+  monitor_native->timeout_source = source;
 }
 
 void
 meta_idle_monitor_native_reset_idletime (MetaIdleMonitor *monitor)
 {
   MetaIdleMonitorNative *monitor_native = META_IDLE_MONITOR_NATIVE (monitor);
-  CheckNativeClosure closure;
+  GList *active_ids = NULL;
+  GList *l;
 
   monitor_native->last_event_time = g_get_monotonic_time ();
 
-  closure.monitor_native = monitor_native;
-  closure.fired_watches = NULL;
-  g_hash_table_foreach_steal (monitor->watches, check_native_watch, &closure);
+  /* Rearm all idle watches at once; their order doesn't change */
+  monitor_native->reset_serial++;
+  monitor_native->next_watch = g_sequence_get_begin_iter (monitor_native->idle_watches);
+  arm_timeout_source (monitor_native);
+
+  if (monitor_native->user_active_watches == NULL)
+    return;
+
+  /* Firing a user active watch removes it, and the callbacks may remove
+   * other watches, so go through the ids */
+  for (l = monitor_native->user_active_watches; l; l = l->next)
+    {
+      MetaIdleMonitorWatch *watch = l->data;
+      active_ids = g_list_prepend (active_ids, GUINT_TO_POINTER (watch->id));
+    }
+
+  for (l = active_ids; l; l = l->next)
+    {
+      MetaIdleMonitorWatch *watch = g_hash_table_lookup (monitor->watches, l->data);
+
+      if (watch)
+        _meta_idle_monitor_watch_fire (watch);
+    }
 
-  g_list_foreach (closure.fired_watches, fire_native_watch, NULL);
-  g_list_free (closure.fired_watches);
+  g_list_free (active_ids);
 }
@@ -35,11 +35,32 @@ struct _MetaCompositor
   guint                  disable_unredirect_count;
   MetaWindow            *unredirected_window;
 
+  /* Unredirection hysteresis, see update_unredirected_window() */
+  MetaWindow            *unredirect_candidate;
+  gint64                 unredirect_candidate_time;
+  gint64                 last_redirect_time;
+  gint64                 unredirect_delay;
+  guint                  unredirect_timeout_id;
+
+  /* Unredirection statistics, logged on every change */
+  gint64                 unredirect_start_time;
+  gint64                 total_unredirected_time;
+  guint                  n_unredirect_toggles;
+
   gint                   switch_workspace_in_progress;
 
   MetaPluginManager *plugin_mgr;
 
   gboolean frame_has_updated_xsurfaces;
+
+  /* Window actors with X damage waiting for flush_damage() */
+  GSList                *damaged_window_actors;
+  guint                  flush_damage_id;
+  guint                  n_pending_damage_events;
+
+  /* Painted area statistics, for the compositor debug topic */
+  guint                  n_painted_frames;
+  guint64                n_painted_pixels;
 };
 
 /* Wait 2ms after vblank before starting to draw next frame */
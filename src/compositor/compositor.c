@@ -53,6 +53,7 @@
 #include <config.h>
 
 #include <clutter/x11/clutter-x11.h>
+#include <gdk/gdk.h> /* for gdk_rectangle_intersect() */
 
 #include "core.h"
 #include <meta/screen.h>
@@ -117,10 +118,63 @@ meta_switch_workspace_completed (MetaCompositor *compositor)
     meta_finish_workspace_switch (compositor);
 }
 
+static void
+flush_damage (MetaCompositor *compositor)
+{
+  GSList *l;
+  int n_rects = 0;
+
+  if (compositor->flush_damage_id != 0)
+    {
+      g_source_remove (compositor->flush_damage_id);
+      compositor->flush_damage_id = 0;
+    }
+
+  if (compositor->damaged_window_actors == NULL)
+    return;
+
+  for (l = compositor->damaged_window_actors; l; l = l->next)
+    {
+      n_rects += meta_window_actor_flush_x11_damage (l->data);
+      g_object_unref (l->data);
+    }
+
+  g_slist_free (compositor->damaged_window_actors);
+  compositor->damaged_window_actors = NULL;
+
+  meta_topic (META_DEBUG_COMPOSITOR,
+              "Processed %u damage events as %d damaged areas\n",
+              compositor->n_pending_damage_events, n_rects);
+
+  compositor->n_pending_damage_events = 0;
+}
+
+static gboolean
+flush_damage_idle (gpointer data)
+{
+  MetaCompositor *compositor = data;
+
+  compositor->flush_damage_id = 0;
+  flush_damage (compositor);
+
+  return G_SOURCE_REMOVE;
+}
+
 void
 meta_compositor_destroy (MetaCompositor *compositor)
 {
   clutter_threads_remove_repaint_func (compositor->repaint_func_id);
+
+  if (compositor->flush_damage_id != 0)
+    g_source_remove (compositor->flush_damage_id);
+  compositor->flush_damage_id = 0;
+
+  g_slist_free_full (compositor->damaged_window_actors, g_object_unref);
+  compositor->damaged_window_actors = NULL;
+
+  if (compositor->unredirect_timeout_id != 0)
+    g_source_remove (compositor->unredirect_timeout_id);
+  compositor->unredirect_timeout_id = 0;
 }
 
 static void
@@ -129,7 +183,25 @@ process_damage (MetaCompositor     *compositor,
                 MetaWindow         *window)
 {
   MetaWindowActor *window_actor = META_WINDOW_ACTOR (meta_window_get_compositor_private (window));
-  meta_window_actor_process_x11_damage (window_actor, event);
+
+  if (meta_window_actor_queue_x11_damage (window_actor, event))
+    compositor->damaged_window_actors =
+      g_slist_prepend (compositor->damaged_window_actors,
+                       g_object_ref (window_actor));
+
+  compositor->n_pending_damage_events++;
+
+  /* The X event source runs at default priority, so this only gets
+   * dispatched once all queued X events were handled; the damage of
+   * the whole batch is then processed at once. */
+  if (compositor->flush_damage_id == 0)
+    {
+      compositor->flush_damage_id = g_idle_add_full (G_PRIORITY_DEFAULT + 1,
+                                                     flush_damage_idle,
+                                                     compositor, NULL);
+      g_source_set_name_by_id (compositor->flush_damage_id,
+                               "[mutter] flush_damage_idle");
+    }
 
   compositor->frame_has_updated_xsurfaces = TRUE;
 }
@@ -398,6 +470,42 @@ meta_end_modal_for_plugin (MetaCompositor *compositor,
     meta_display_sync_wayland_input_focus (display);
 }
 
+/* All the window groups paint within the same stage redraw clip, so the
+ * painted area is accounted once per stage frame, here.
+ */
+static void
+log_painted_area (MetaCompositor *compositor)
+{
+  ClutterStage *stage = CLUTTER_STAGE (compositor->stage);
+  cairo_rectangle_int_t stage_rect, clip_rect, painted_rect;
+  guint64 n_pixels, n_stage_pixels;
+
+  stage_rect.x = stage_rect.y = 0;
+  stage_rect.width = clutter_actor_get_width (compositor->stage);
+  stage_rect.height = clutter_actor_get_height (compositor->stage);
+
+  clutter_stage_get_redraw_clip_bounds (stage, &clip_rect);
+
+  if (!gdk_rectangle_intersect (&clip_rect, &stage_rect, &painted_rect))
+    return;
+
+  n_pixels = (guint64) painted_rect.width * painted_rect.height;
+  n_stage_pixels = (guint64) stage_rect.width * stage_rect.height;
+
+  compositor->n_painted_frames++;
+  compositor->n_painted_pixels += n_pixels;
+
+  meta_topic (META_DEBUG_COMPOSITOR,
+              "Frame %u: painted %dx%d+%d+%d, %" G_GUINT64_FORMAT
+              " of %" G_GUINT64_FORMAT " pixels (%" G_GUINT64_FORMAT
+              " pixels per frame on average)\n",
+              compositor->n_painted_frames,
+              painted_rect.width, painted_rect.height,
+              painted_rect.x, painted_rect.y,
+              n_pixels, n_stage_pixels,
+              compositor->n_painted_pixels / compositor->n_painted_frames);
+}
+
 static void
 after_stage_paint (ClutterStage *stage,
                    gpointer      data)
@@ -408,6 +516,8 @@ after_stage_paint (ClutterStage *stage,
   for (l = compositor->windows; l; l = l->next)
     meta_window_actor_post_paint (l->data);
 
+  log_painted_area (compositor);
+
 #ifdef HAVE_WAYLAND
   if (meta_is_wayland_compositor ())
     meta_wayland_compositor_paint_finished (meta_wayland_compositor_get_default ());
@@ -596,17 +706,51 @@ meta_shape_cow_for_window (MetaCompositor *compositor,
     }
 }
 
+/* A window has to stay eligible for unredirection this long (in us)
+ * before it is unredirected; windows that get redirected again soon
+ * after being unredirected, e.g. because of notifications popping up
+ * over a fullscreen game, double the delay up to the maximum. */
+#define UNREDIRECT_DELAY_MIN (250 * 1000)
+#define UNREDIRECT_DELAY_MAX (8 * 1000 * 1000)
+#define UNREDIRECT_SHORT_DURATION (5 * 1000 * 1000)
+
 static void
 set_unredirected_window (MetaCompositor *compositor,
                          MetaWindow     *window)
 {
+  gint64 now;
+
   if (compositor->unredirected_window == window)
     return;
 
+  now = g_get_monotonic_time ();
+
   if (compositor->unredirected_window != NULL)
     {
       MetaWindowActor *window_actor = META_WINDOW_ACTOR (meta_window_get_compositor_private (compositor->unredirected_window));
+      gint64 duration = now - compositor->unredirect_start_time;
+
       meta_window_actor_set_unredirected (window_actor, FALSE);
+
+      if (duration < UNREDIRECT_SHORT_DURATION)
+        compositor->unredirect_delay = MIN (compositor->unredirect_delay * 2,
+                                            UNREDIRECT_DELAY_MAX);
+      else
+        compositor->unredirect_delay = UNREDIRECT_DELAY_MIN;
+
+      compositor->last_redirect_time = now;
+      compositor->total_unredirected_time += duration;
+      compositor->n_unredirect_toggles++;
+
+      meta_topic (META_DEBUG_COMPOSITOR,
+                  "Redirected %s after %" G_GINT64_FORMAT " ms unredirected "
+                  "(%u toggles, %" G_GINT64_FORMAT " ms unredirected in total, "
+                  "next delay %" G_GINT64_FORMAT " ms)\n",
+                  compositor->unredirected_window->desc,
+                  duration / 1000,
+                  compositor->n_unredirect_toggles,
+                  compositor->total_unredirected_time / 1000,
+                  compositor->unredirect_delay / 1000);
     }
 
   meta_shape_cow_for_window (compositor, window);
@@ -616,6 +760,84 @@ set_unredirected_window (MetaCompositor *compositor,
     {
       MetaWindowActor *window_actor = META_WINDOW_ACTOR (meta_window_get_compositor_private (compositor->unredirected_window));
       meta_window_actor_set_unredirected (window_actor, TRUE);
+
+      compositor->unredirect_start_time = now;
+
+      meta_topic (META_DEBUG_COMPOSITOR, "Unredirected %s\n",
+                  compositor->unredirected_window->desc);
+    }
+}
+
+static gboolean
+unredirect_timeout (gpointer data)
+{
+  MetaCompositor *compositor = data;
+
+  compositor->unredirect_timeout_id = 0;
+
+  /* Get pre_paint_windows() to look at the candidate again */
+  clutter_actor_queue_redraw (compositor->stage);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+clear_unredirect_candidate (MetaCompositor *compositor)
+{
+  compositor->unredirect_candidate = NULL;
+
+  if (compositor->unredirect_timeout_id != 0)
+    g_source_remove (compositor->unredirect_timeout_id);
+  compositor->unredirect_timeout_id = 0;
+}
+
+/* Redirecting has to happen right away, since nothing can be drawn on
+ * top of an unredirected window; unredirecting waits until @window
+ * stayed eligible for a while, to avoid expensive redirect/unredirect
+ * cycles when windows briefly show up above it. */
+static void
+update_unredirected_window (MetaCompositor *compositor,
+                            MetaWindow     *window)
+{
+  gint64 now, eligible_time;
+
+  if (window == compositor->unredirected_window)
+    {
+      clear_unredirect_candidate (compositor);
+      return;
+    }
+
+  set_unredirected_window (compositor, NULL);
+
+  if (window == NULL)
+    {
+      clear_unredirect_candidate (compositor);
+      return;
+    }
+
+  now = g_get_monotonic_time ();
+
+  if (window != compositor->unredirect_candidate)
+    {
+      clear_unredirect_candidate (compositor);
+      compositor->unredirect_candidate = window;
+      compositor->unredirect_candidate_time = now;
+    }
+
+  eligible_time = MAX (compositor->unredirect_candidate_time,
+                       compositor->last_redirect_time) +
+                  compositor->unredirect_delay;
+
+  if (now >= eligible_time)
+    {
+      clear_unredirect_candidate (compositor);
+      set_unredirected_window (compositor, window);
+    }
+  else if (compositor->unredirect_timeout_id == 0)
+    {
+      compositor->unredirect_timeout_id =
+        g_timeout_add ((eligible_time - now) / 1000 + 1,
+                       unredirect_timeout, compositor);
     }
 }
 
@@ -642,6 +864,9 @@ meta_compositor_remove_window (MetaCompositor *compositor,
   if (compositor->unredirected_window == window)
     set_unredirected_window (compositor, NULL);
 
+  if (compositor->unredirect_candidate == window)
+    clear_unredirect_candidate (compositor);
+
   meta_window_actor_destroy (window_actor);
 }
 
@@ -1045,6 +1270,9 @@ pre_paint_windows (MetaCompositor *compositor)
                                                                     NULL);
     }
 
+  /* Make sure no damage received so far is left out of this frame */
+  flush_damage (compositor);
+
   if (compositor->windows == NULL)
     return;
 
@@ -1052,9 +1280,9 @@ pre_paint_windows (MetaCompositor *compositor)
 
   if (meta_window_actor_should_unredirect (top_window) &&
       compositor->disable_unredirect_count == 0)
-    set_unredirected_window (compositor, meta_window_actor_get_meta_window (top_window));
+    update_unredirected_window (compositor, meta_window_actor_get_meta_window (top_window));
   else
-    set_unredirected_window (compositor, NULL);
+    update_unredirected_window (compositor, NULL);
 
   for (l = compositor->windows; l; l = l->next)
     meta_window_actor_pre_paint (l->data);
@@ -1117,6 +1345,7 @@ meta_compositor_new (MetaDisplay *display)
 
   compositor = g_new0 (MetaCompositor, 1);
   compositor->display = display;
+  compositor->unredirect_delay = UNREDIRECT_DELAY_MIN;
 
   if (g_getenv("META_DISABLE_MIPMAPS"))
     compositor->no_mipmaps = TRUE;
@@ -70,6 +70,13 @@
  * gradient, or a repeated texture for wallpaper, or a pre-rendered
  * texture the size of the screen), and we draw with that, possibly
  * adding the vignette and opacity.
+ *
+ * The vignette is a per-pixel shader, and most of the time the
+ * background is only partially visible and doesn't change; so once the
+ * background and the vignette parameters have stopped changing, we bake
+ * the vignetted background into a texture the size of the actor and
+ * paint the visible parts from that. While they are animating we keep
+ * drawing with the shader directly rather than re-baking every frame.
  */
 
 #include <config.h>
@@ -79,6 +86,7 @@
 #include "cogl-utils.h"
 #include "clutter-utils.h"
 #include <meta/errors.h>
+#include <meta/util.h>
 #include "meta-background-actor-private.h"
 #include "meta-background-private.h"
 #include "meta-cullable.h"
@@ -142,6 +150,11 @@ struct _MetaBackgroundActorPrivate
   cairo_rectangle_int_t texture_area;
   gboolean force_bilinear;
 
+  /* The background with the vignette applied, see the comment at the top */
+  CoglTexture *vignette_texture;
+  CoglPipeline *vignette_pipeline;
+  gboolean changed_since_paint;
+
   cairo_region_t *clip_region;
 };
 
@@ -161,6 +174,23 @@ set_clip_region (MetaBackgroundActor *self,
     priv->clip_region = cairo_region_copy (clip_region);
 }
 
+static void
+free_vignette_texture (MetaBackgroundActor *self)
+{
+  MetaBackgroundActorPrivate *priv = self->priv;
+
+  if (priv->vignette_texture)
+    {
+      cogl_object_unref (priv->vignette_texture);
+      priv->vignette_texture = NULL;
+    }
+  if (priv->vignette_pipeline)
+    {
+      cogl_object_unref (priv->vignette_pipeline);
+      priv->vignette_pipeline = NULL;
+    }
+}
+
 static void
 meta_background_actor_dispose (GObject *object)
 {
@@ -169,6 +199,7 @@ meta_background_actor_dispose (GObject *object)
 
   set_clip_region (self, NULL);
   meta_background_actor_set_background (self, NULL);
+  free_vignette_texture (self);
   if (priv->pipeline)
     {
       cogl_object_unref (priv->pipeline);
@@ -289,6 +320,11 @@ setup_pipeline (MetaBackgroundActor   *self,
     {
       cogl_object_unref (priv->pipeline);
       priv->pipeline = NULL;
+      if (priv->vignette_pipeline)
+        {
+          cogl_object_unref (priv->vignette_pipeline);
+          priv->vignette_pipeline = NULL;
+        }
     }
 
   if (priv->pipeline == NULL)
@@ -403,6 +439,81 @@ paint_clipped_rectangle (CoglFramebuffer       *fb,
                                             tx1, ty1, tx2, ty2);
 }
 
+static gboolean
+ensure_vignette_texture (MetaBackgroundActor   *self,
+                         cairo_rectangle_int_t *actor_pixel_rect)
+{
+  MetaBackgroundActorPrivate *priv = self->priv;
+  CoglFramebuffer *fbo;
+  CoglPipeline *pipeline;
+  CoglPipelineFilter filter;
+  CoglError *catch_error = NULL;
+  gint64 start_time;
+
+  if (priv->vignette_texture != NULL &&
+      (int)cogl_texture_get_width (priv->vignette_texture) == actor_pixel_rect->width &&
+      (int)cogl_texture_get_height (priv->vignette_texture) == actor_pixel_rect->height)
+    goto out;
+
+  free_vignette_texture (self);
+
+  start_time = g_get_monotonic_time ();
+
+  priv->vignette_texture = meta_create_texture (actor_pixel_rect->width,
+                                                actor_pixel_rect->height,
+                                                COGL_TEXTURE_COMPONENTS_RGBA,
+                                                META_TEXTURE_FLAGS_NONE);
+  fbo = cogl_offscreen_new_with_texture (priv->vignette_texture);
+
+  if (!cogl_framebuffer_allocate (fbo, &catch_error))
+    {
+      /* Most likely larger than the maximum texture size; just keep
+       * drawing with the shader.
+       */
+      cogl_error_free (catch_error);
+      cogl_object_unref (fbo);
+      free_vignette_texture (self);
+      return FALSE;
+    }
+
+  cogl_framebuffer_orthographic (fbo,
+                                 actor_pixel_rect->x,
+                                 actor_pixel_rect->y,
+                                 actor_pixel_rect->x + actor_pixel_rect->width,
+                                 actor_pixel_rect->y + actor_pixel_rect->height,
+                                 -1., 1.);
+
+  /* Bake in the brightness, but not the opacity, which is applied when
+   * painting the result.
+   */
+  pipeline = cogl_pipeline_copy (priv->pipeline);
+  cogl_pipeline_set_blend (pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+  cogl_pipeline_set_color4f (pipeline,
+                             priv->brightness, priv->brightness,
+                             priv->brightness, 1.0);
+  filter = priv->force_bilinear ? COGL_PIPELINE_FILTER_LINEAR : COGL_PIPELINE_FILTER_NEAREST;
+  cogl_pipeline_set_layer_filters (pipeline, 0, filter, filter);
+
+  paint_clipped_rectangle (fbo, pipeline, actor_pixel_rect, &priv->texture_area);
+
+  cogl_object_unref (pipeline);
+  cogl_object_unref (fbo);
+
+  meta_topic (META_DEBUG_COMPOSITOR,
+              "Baked vignette for monitor %d (%dx%d) in %" G_GINT64_FORMAT " us\n",
+              priv->monitor, actor_pixel_rect->width, actor_pixel_rect->height,
+              g_get_monotonic_time () - start_time);
+
+ out:
+  if (priv->vignette_pipeline == NULL)
+    {
+      priv->vignette_pipeline = make_pipeline (priv->pipeline_flags & ~PIPELINE_VIGNETTE);
+      cogl_pipeline_set_layer_texture (priv->vignette_pipeline, 0, priv->vignette_texture);
+    }
+
+  return TRUE;
+}
+
 static gboolean
 meta_background_actor_get_paint_volume (ClutterActor       *actor,
                                         ClutterPaintVolume *volume)
@@ -418,6 +529,9 @@ meta_background_actor_paint (ClutterActor *actor)
   ClutterActorBox actor_box;
   cairo_rectangle_int_t actor_pixel_rect;
   CoglFramebuffer *fb;
+  CoglPipeline *pipeline;
+  cairo_rectangle_int_t *texture_area;
+  gboolean effects_changed;
   int i;
 
   if ((priv->clip_region && cairo_region_is_empty (priv->clip_region)))
@@ -429,9 +543,43 @@ meta_background_actor_paint (ClutterActor *actor)
   actor_pixel_rect.width = actor_box.x2 - actor_box.x1;
   actor_pixel_rect.height = actor_box.y2 - actor_box.y1;
 
+  /* If nothing of this monitor is visible, don't even ask the background
+   * for a texture; that would prerender a blend nobody is going to see.
+   */
+  if (priv->clip_region &&
+      cairo_region_contains_rectangle (priv->clip_region,
+                                       &actor_pixel_rect) == CAIRO_REGION_OVERLAP_OUT)
+    return;
+
+  effects_changed = priv->changed_since_paint;
+  priv->changed_since_paint = FALSE;
+
   setup_pipeline (self, &actor_pixel_rect);
   set_glsl_parameters (self, &actor_pixel_rect);
 
+  pipeline = priv->pipeline;
+  texture_area = &priv->texture_area;
+
+  if ((priv->pipeline_flags & PIPELINE_VIGNETTE) == 0 || effects_changed)
+    {
+      free_vignette_texture (self);
+    }
+  else if (ensure_vignette_texture (self, &actor_pixel_rect))
+    {
+      guint8 opacity = clutter_actor_get_paint_opacity (actor);
+      CoglPipelineFilter filter;
+
+      if (meta_actor_painting_untransformed (actor_pixel_rect.width, actor_pixel_rect.height, NULL, NULL))
+        filter = COGL_PIPELINE_FILTER_NEAREST;
+      else
+        filter = COGL_PIPELINE_FILTER_LINEAR;
+
+      pipeline = priv->vignette_pipeline;
+      cogl_pipeline_set_color4ub (pipeline, opacity, opacity, opacity, opacity);
+      cogl_pipeline_set_layer_filters (pipeline, 0, filter, filter);
+      texture_area = &actor_pixel_rect;
+    }
+
   /* Limit to how many separate rectangles we'll draw; beyond this just
    * fall back and draw the whole thing */
 #define MAX_RECTS 64
@@ -453,14 +601,14 @@ meta_background_actor_paint (ClutterActor *actor)
                if (!gdk_rectangle_intersect (&actor_pixel_rect, &rect, &rect))
                  continue;
 
-               paint_clipped_rectangle (fb, priv->pipeline, &rect, &priv->texture_area);
+               paint_clipped_rectangle (fb, pipeline, &rect, texture_area);
              }
 
            return;
         }
     }
 
-  paint_clipped_rectangle (fb, priv->pipeline, &actor_pixel_rect, &priv->texture_area);
+  paint_clipped_rectangle (fb, pipeline, &actor_pixel_rect, texture_area);
 }
 
 static void
@@ -701,6 +849,7 @@ invalidate_pipeline (MetaBackgroundActor *self,
   MetaBackgroundActorPrivate *priv = self->priv;
 
   priv->changed |= changed;
+  priv->changed_since_paint = TRUE;
 }
 
 static void
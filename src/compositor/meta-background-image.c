@@ -24,12 +24,19 @@
 
 #include <config.h>
 
+#include <math.h>
 #include <gio/gio.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <clutter/clutter.h>
 #include <meta/meta-background-image.h>
+#include <meta/util.h>
+#include "meta-background-private.h"
 #include "cogl-utils.h"
 
+/* Images are fed to the loader in chunks of this size, so that loaders
+ * that support it can decode progressively */
+#define LOAD_CHUNK_SIZE (64 * 1024)
+
 enum
 {
   LOADED,
@@ -42,7 +49,13 @@ struct _MetaBackgroundImageCache
 {
   GObject parent_instance;
 
+  /* Images loaded at full size, and images downscaled on load;
+   * both are keyed by file */
   GHashTable *images;
+  GHashTable *scaled_images;
+
+  /* Memory used by the textures of all live images */
+  gsize texture_bytes;
 };
 
 struct _MetaBackgroundImageCacheClass
@@ -58,8 +71,21 @@ struct _MetaBackgroundImage
   gboolean in_cache;
   gboolean loaded;
   CoglTexture *texture;
+  gsize texture_bytes;
+
+  /* The size the image was downscaled to fit on load, or 0 */
+  int max_width;
+  int max_height;
 };
 
+typedef struct
+{
+  int max_width;
+  int max_height;
+  int image_width;
+  int image_height;
+} LoadData;
+
 struct _MetaBackgroundImageClass
 {
   GObjectClass parent_class;
@@ -71,23 +97,39 @@ static void
 meta_background_image_cache_init (MetaBackgroundImageCache *cache)
 {
   cache->images = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+  cache->scaled_images = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
 }
 
 static void
-meta_background_image_cache_finalize (GObject *object)
+uncache_images (GHashTable *images)
 {
-  MetaBackgroundImageCache *cache = META_BACKGROUND_IMAGE_CACHE (object);
   GHashTableIter iter;
   gpointer key, value;
 
-  g_hash_table_iter_init (&iter, cache->images);
+  g_hash_table_iter_init (&iter, images);
   while (g_hash_table_iter_next (&iter, &key, &value))
     {
       MetaBackgroundImage *image = value;
       image->in_cache = FALSE;
     }
 
-  g_hash_table_destroy (cache->images);
+  g_hash_table_destroy (images);
+}
+
+static GHashTable *
+get_image_table (MetaBackgroundImageCache *cache,
+                 MetaBackgroundImage      *image)
+{
+  return image->max_width > 0 ? cache->scaled_images : cache->images;
+}
+
+static void
+meta_background_image_cache_finalize (GObject *object)
+{
+  MetaBackgroundImageCache *cache = META_BACKGROUND_IMAGE_CACHE (object);
+
+  uncache_images (cache->images);
+  uncache_images (cache->scaled_images);
 
   G_OBJECT_CLASS (meta_background_image_cache_parent_class)->finalize (object);
 }
@@ -116,15 +158,46 @@ meta_background_image_cache_get_default (void)
   return cache;
 }
 
+static void
+on_size_prepared (GdkPixbufLoader *loader,
+                  int              width,
+                  int              height,
+                  LoadData        *data)
+{
+  double scale;
+
+  data->image_width = width;
+  data->image_height = height;
+
+  if (data->max_width <= 0 || data->max_height <= 0)
+    return;
+
+  /* Keep the aspect ratio, and keep the image at least as large as the
+   * area in both dimensions, so that zooming it to fill the screen
+   * still doesn't need to scale it up.
+   */
+  scale = MAX ((double) data->max_width / width,
+               (double) data->max_height / height);
+  if (scale >= 1.0)
+    return;
+
+  gdk_pixbuf_loader_set_size (loader,
+                              MAX (1, (int) ceil (width * scale)),
+                              MAX (1, (int) ceil (height * scale)));
+}
+
 static void
 load_file (GTask               *task,
            MetaBackgroundImage *image,
-           gpointer             task_data,
+           LoadData            *data,
            GCancellable        *cancellable)
 {
   GError *error = NULL;
   GdkPixbuf *pixbuf;
+  GdkPixbufLoader *loader;
   GFileInputStream *stream;
+  guchar *buffer;
+  gssize n_read;
 
   stream = g_file_read (image->file, NULL, &error);
   if (stream == NULL)
@@ -133,9 +206,44 @@ load_file (GTask               *task,
       return;
     }
 
-  pixbuf = gdk_pixbuf_new_from_stream (G_INPUT_STREAM (stream), NULL, &error);
+  /* Letting the loader know the final size as soon as the image header
+   * is read allows loaders like the JPEG one to decode straight to a
+   * smaller size, rather than decoding the full image and scaling it.
+   */
+  loader = gdk_pixbuf_loader_new ();
+  g_signal_connect (loader, "size-prepared",
+                    G_CALLBACK (on_size_prepared), data);
+
+  buffer = g_malloc (LOAD_CHUNK_SIZE);
+  while ((n_read = g_input_stream_read (G_INPUT_STREAM (stream),
+                                        buffer, LOAD_CHUNK_SIZE,
+                                        NULL, &error)) > 0)
+    {
+      if (!gdk_pixbuf_loader_write (loader, buffer, n_read, &error))
+        break;
+    }
+  g_free (buffer);
   g_object_unref (stream);
 
+  if (error == NULL)
+    gdk_pixbuf_loader_close (loader, &error);
+  else
+    gdk_pixbuf_loader_close (loader, NULL);
+
+  pixbuf = NULL;
+  if (error == NULL)
+    {
+      pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+      if (pixbuf != NULL)
+        g_object_ref (pixbuf);
+      else
+        g_set_error_literal (&error, GDK_PIXBUF_ERROR,
+                             GDK_PIXBUF_ERROR_FAILED,
+                             "No image data");
+    }
+
+  g_object_unref (loader);
+
   if (pixbuf == NULL)
     {
       g_task_return_error (task, error);
@@ -153,13 +261,16 @@ file_loaded (GObject      *source_object,
   MetaBackgroundImage *image = META_BACKGROUND_IMAGE (source_object);
   GError *error = NULL;
   GTask *task;
+  LoadData *data;
   CoglTexture *texture;
   GdkPixbuf *pixbuf;
+  char *uri;
   int width, height, row_stride;
   guchar *pixels;
   gboolean has_alpha;
 
   task = G_TASK (result);
+  data = g_task_get_task_data (task);
   pixbuf = g_task_propagate_pointer (task, &error);
 
   if (pixbuf == NULL)
@@ -190,9 +301,20 @@ file_loaded (GObject      *source_object,
     {
       g_warning ("Failed to create texture for background");
       cogl_object_unref (texture);
+      goto out;
     }
 
   image->texture = texture;
+  image->texture_bytes = (gsize) width * height * (has_alpha ? 4 : 3);
+  image->cache->texture_bytes += image->texture_bytes;
+
+  uri = g_file_get_uri (image->file);
+  meta_topic (META_DEBUG_COMPOSITOR,
+              "Loaded background '%s' at %dx%d (image is %dx%d), "
+              "background textures now use %" G_GSIZE_FORMAT " KiB\n",
+              uri, width, height, data->image_width, data->image_height,
+              image->cache->texture_bytes / 1024);
+  g_free (uri);
 
 out:
   if (pixbuf != NULL)
@@ -202,6 +324,37 @@ out:
   g_signal_emit (image, signals[LOADED], 0);
 }
 
+static MetaBackgroundImage *
+load_image (MetaBackgroundImageCache *cache,
+            GFile                    *file,
+            int                       max_width,
+            int                       max_height)
+{
+  MetaBackgroundImage *image;
+  LoadData *data;
+  GTask *task;
+
+  image = g_object_new (META_TYPE_BACKGROUND_IMAGE, NULL);
+  image->cache = cache;
+  image->in_cache = TRUE;
+  image->file = g_object_ref (file);
+  image->max_width = max_width;
+  image->max_height = max_height;
+  g_hash_table_insert (get_image_table (cache, image), image->file, image);
+
+  data = g_new0 (LoadData, 1);
+  data->max_width = max_width;
+  data->max_height = max_height;
+
+  task = g_task_new (image, NULL, file_loaded, NULL);
+  g_task_set_task_data (task, data, g_free);
+
+  g_task_run_in_thread (task, (GTaskThreadFunc) load_file);
+  g_object_unref (task);
+
+  return image;
+}
+
 /**
  * meta_background_image_cache_load:
  * @cache: a #MetaBackgroundImageCache
@@ -215,6 +368,11 @@ out:
  * signal will be emitted exactly once. The 'loaded' state means that the
  * loading process finished, whether it succeeded or failed.
  *
+ * The image is loaded at its full size. While it is alive, a #MetaBackground
+ * using the same file shares it rather than loading a downscaled copy, so
+ * preloading through this function avoids a second decode, but the full
+ * size texture is kept for as long as any reference to it is held.
+ *
  * Return value: (transfer full): a #MetaBackgroundImage to dereference to get the loaded texture
  */
 MetaBackgroundImage *
@@ -222,7 +380,6 @@ meta_background_image_cache_load (MetaBackgroundImageCache *cache,
                                   GFile                    *file)
 {
   MetaBackgroundImage *image;
-  GTask *task;
 
   g_return_val_if_fail (META_IS_BACKGROUND_IMAGE_CACHE (cache), NULL);
   g_return_val_if_fail (file != NULL, NULL);
@@ -231,18 +388,54 @@ meta_background_image_cache_load (MetaBackgroundImageCache *cache,
   if (image != NULL)
     return g_object_ref (image);
 
-  image = g_object_new (META_TYPE_BACKGROUND_IMAGE, NULL);
-  image->cache = cache;
-  image->in_cache = TRUE;
-  image->file = g_object_ref (file);
-  g_hash_table_insert (cache->images, image->file, image);
+  return load_image (cache, file, 0, 0);
+}
 
-  task = g_task_new (image, NULL, file_loaded, NULL);
+/*
+ * meta_background_image_cache_load_scaled:
+ * @cache: a #MetaBackgroundImageCache
+ * @file: #GFile to load
+ * @max_width: width of the area the image will be drawn to
+ * @max_height: height of the area the image will be drawn to
+ *
+ * Like meta_background_image_cache_load(), but images larger than the
+ * given area are downscaled while loading, keeping their aspect ratio,
+ * to the smallest size that still covers the area. Only suitable for
+ * images that will be scaled to the area when drawn. If the file is
+ * already loaded or loading at full size, that image is returned instead.
+ */
+MetaBackgroundImage *
+meta_background_image_cache_load_scaled (MetaBackgroundImageCache *cache,
+                                         GFile                    *file,
+                                         int                       max_width,
+                                         int                       max_height)
+{
+  MetaBackgroundImage *image;
 
-  g_task_run_in_thread (task, (GTaskThreadFunc) load_file);
-  g_object_unref (task);
+  g_return_val_if_fail (META_IS_BACKGROUND_IMAGE_CACHE (cache), NULL);
+  g_return_val_if_fail (file != NULL, NULL);
 
-  return image;
+  if (max_width <= 0 || max_height <= 0)
+    return meta_background_image_cache_load (cache, file);
+
+  image = g_hash_table_lookup (cache->scaled_images, file);
+  if (image != NULL)
+    {
+      if (image->max_width >= max_width && image->max_height >= max_height)
+        return g_object_ref (image);
+
+      /* Too small for the requested area; users of the old image keep it */
+      g_hash_table_remove (cache->scaled_images, file);
+      image->in_cache = FALSE;
+    }
+
+  /* Someone is holding the full size image, typically a preload; sharing
+   * it costs nothing, while a scaled copy would mean a second decode */
+  image = g_hash_table_lookup (cache->images, file);
+  if (image != NULL)
+    return g_object_ref (image);
+
+  return load_image (cache, file, max_width, max_height);
 }
 
 /**
@@ -263,11 +456,18 @@ meta_background_image_cache_purge (MetaBackgroundImageCache *cache,
   g_return_if_fail (file != NULL);
 
   image = g_hash_table_lookup (cache->images, file);
-  if (image == NULL)
-    return;
+  if (image != NULL)
+    {
+      g_hash_table_remove (cache->images, image->file);
+      image->in_cache = FALSE;
+    }
 
-  g_hash_table_remove (cache->images, image->file);
-  image->in_cache = FALSE;
+  image = g_hash_table_lookup (cache->scaled_images, file);
+  if (image != NULL)
+    {
+      g_hash_table_remove (cache->scaled_images, image->file);
+      image->in_cache = FALSE;
+    }
 }
 
 G_DEFINE_TYPE (MetaBackgroundImage, meta_background_image, G_TYPE_OBJECT);
@@ -283,10 +483,13 @@ meta_background_image_finalize (GObject *object)
   MetaBackgroundImage *image = META_BACKGROUND_IMAGE (object);
 
   if (image->in_cache)
-    g_hash_table_remove (image->cache->images, image->file);
+    g_hash_table_remove (get_image_table (image->cache, image), image->file);
 
   if (image->texture)
-    cogl_object_unref (image->texture);
+    {
+      image->cache->texture_bytes -= image->texture_bytes;
+      cogl_object_unref (image->texture);
+    }
   if (image->file)
     g_object_unref (image->file);
 
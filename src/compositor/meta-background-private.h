@@ -5,11 +5,17 @@
 
 #include <config.h>
 
-#include "meta-background-private.h"
+#include <meta/meta-background.h>
+#include <meta/meta-background-image.h>
 
 CoglTexture *meta_background_get_texture (MetaBackground         *self,
                                           int                     monitor_index,
                                           cairo_rectangle_int_t  *texture_area,
                                           CoglPipelineWrapMode   *wrap_mode);
 
+MetaBackgroundImage *meta_background_image_cache_load_scaled (MetaBackgroundImageCache *cache,
+                                                              GFile                    *file,
+                                                              int                       max_width,
+                                                              int                       max_height);
+
 #endif /* META_BACKGROUND_PRIVATE_H */
@@ -17,8 +17,10 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
 #include <meta/meta-background.h>
 #include <meta/meta-background-image.h>
+#include <meta/util.h>
 #include "meta-background-private.h"
 #include "cogl-utils.h"
 
@@ -55,6 +57,10 @@ struct _MetaBackgroundPrivate
   GFile *file2;
   MetaBackgroundImage *background_image2;
 
+  /* Area the images were downscaled to fit when loading, or 0 */
+  int image_max_width;
+  int image_max_height;
+
   CoglTexture *color_texture;
   CoglTexture *wallpaper_texture;
 
@@ -71,8 +77,29 @@ enum
 
 G_DEFINE_TYPE (MetaBackground, meta_background, G_TYPE_OBJECT)
 
+/* Smallest change in the blend factor that is re-rendered. Between two
+ * images, a change of 1/255 moves a channel by at most one level of an
+ * 8-bit framebuffer; anything smaller can't change the result.
+ */
+#define BLEND_FACTOR_STEP (1.0 / 255)
+
 static GSList *all_backgrounds = NULL;
 
+static void
+free_monitor_fbo (MetaBackgroundMonitor *monitor)
+{
+  if (monitor->fbo)
+    {
+      cogl_object_unref (monitor->fbo);
+      monitor->fbo = NULL;
+    }
+  if (monitor->texture)
+    {
+      cogl_object_unref (monitor->texture);
+      monitor->texture = NULL;
+    }
+}
+
 static void
 free_fbos (MetaBackground *self)
 {
@@ -81,19 +108,7 @@ free_fbos (MetaBackground *self)
   int i;
 
   for (i = 0; i < priv->n_monitors; i++)
-    {
-      MetaBackgroundMonitor *monitor = &priv->monitors[i];
-      if (monitor->fbo)
-        {
-          cogl_object_unref (monitor->fbo);
-          monitor->fbo = NULL;
-        }
-      if (monitor->texture)
-        {
-          cogl_object_unref (monitor->texture);
-          monitor->texture = NULL;
-        }
-    }
+    free_monitor_fbo (&priv->monitors[i]);
 }
 
 static void
@@ -122,6 +137,84 @@ free_wallpaper_texture (MetaBackground *self)
   priv->wallpaper_allocation_failed = FALSE;
 }
 
+static void set_file (MetaBackground       *self,
+                      GFile               **filep,
+                      MetaBackgroundImage **imagep,
+                      GFile                *file);
+static void mark_changed (MetaBackground *self);
+
+/* Images that are always scaled to the monitor or screen size can be
+ * downscaled while loading; the others are drawn at their natural size.
+ * Except for the spanned style, the image is scaled to each monitor on
+ * its own, so it only needs to cover the largest monitor.
+ */
+static void
+get_image_max_size (MetaBackground          *self,
+                    GDesktopBackgroundStyle  style,
+                    int                     *max_width,
+                    int                     *max_height)
+{
+  MetaBackgroundPrivate *priv = self->priv;
+  int i;
+
+  *max_width = 0;
+  *max_height = 0;
+
+  if (priv->screen == NULL)
+    return;
+
+  switch (style)
+    {
+    case G_DESKTOP_BACKGROUND_STYLE_STRETCHED:
+    case G_DESKTOP_BACKGROUND_STYLE_SCALED:
+    case G_DESKTOP_BACKGROUND_STYLE_ZOOM:
+      for (i = 0; i < meta_screen_get_n_monitors (priv->screen); i++)
+        {
+          MetaRectangle geometry;
+
+          meta_screen_get_monitor_geometry (priv->screen, i, &geometry);
+          *max_width = MAX (*max_width, geometry.width);
+          *max_height = MAX (*max_height, geometry.height);
+        }
+      break;
+    case G_DESKTOP_BACKGROUND_STYLE_SPANNED:
+      meta_screen_get_size (priv->screen, max_width, max_height);
+      break;
+    default:
+      break;
+    }
+}
+
+/* Drops the images if they were loaded for a different size; the
+ * caller needs to set the files again.
+ */
+static gboolean
+update_image_max_size (MetaBackground          *self,
+                       GDesktopBackgroundStyle  style)
+{
+  MetaBackgroundPrivate *priv = self->priv;
+  int max_width, max_height;
+
+  get_image_max_size (self, style, &max_width, &max_height);
+  if (max_width == priv->image_max_width &&
+      max_height == priv->image_max_height)
+    return FALSE;
+
+  /* Images loaded for a larger area are still good enough */
+  if (max_width > 0 && priv->image_max_width > 0 &&
+      max_width <= priv->image_max_width &&
+      max_height <= priv->image_max_height)
+    return FALSE;
+
+  priv->image_max_width = max_width;
+  priv->image_max_height = max_height;
+
+  set_file (self, &priv->file1, &priv->background_image1, NULL);
+  set_file (self, &priv->file2, &priv->background_image2, NULL);
+
+  return TRUE;
+}
+
 static void
 on_monitors_changed (MetaScreen     *screen,
                      MetaBackground *self)
@@ -142,6 +235,24 @@ on_monitors_changed (MetaScreen     *screen,
 
       for (i = 0; i < priv->n_monitors; i++)
         priv->monitors[i].dirty = TRUE;
+
+      if (priv->file1 || priv->file2)
+        {
+          GFile *file1 = priv->file1 ? g_object_ref (priv->file1) : NULL;
+          GFile *file2 = priv->file2 ? g_object_ref (priv->file2) : NULL;
+
+          if (update_image_max_size (self, priv->style))
+            {
+              set_file (self, &priv->file1, &priv->background_image1, file1);
+              set_file (self, &priv->file2, &priv->background_image2, file2);
+            }
+
+          g_clear_object (&file1);
+          g_clear_object (&file2);
+        }
+
+      /* Let actors know; anything they cached from us is out of date */
+      mark_changed (self);
     }
 }
 
@@ -280,7 +391,9 @@ set_file (MetaBackground       *self,
           MetaBackgroundImageCache *cache = meta_background_image_cache_get_default ();
 
           *filep = g_object_ref (file);
-          *imagep = meta_background_image_cache_load (cache, file);
+          *imagep = meta_background_image_cache_load_scaled (cache, file,
+                                                             self->priv->image_max_width,
+                                                             self->priv->image_max_height);
           g_signal_connect (*imagep, "loaded",
                             G_CALLBACK (on_background_loaded), self);
         }
@@ -696,6 +809,34 @@ get_wrap_mode (GDesktopBackgroundStyle style)
     }
 }
 
+/* Except for the wallpaper and spanned styles, what we prerender for a
+ * monitor only depends on its size; monitors of the same size (like a
+ * mirrored or identical pair) share the texture of the first of them.
+ */
+static int
+get_prerender_monitor (MetaBackground *self,
+                       int             monitor_index,
+                       MetaRectangle  *geometry)
+{
+  MetaBackgroundPrivate *priv = self->priv;
+  int i;
+
+  if (priv->style == G_DESKTOP_BACKGROUND_STYLE_WALLPAPER ||
+      priv->style == G_DESKTOP_BACKGROUND_STYLE_SPANNED)
+    return monitor_index;
+
+  for (i = 0; i < monitor_index; i++)
+    {
+      MetaRectangle other;
+
+      meta_screen_get_monitor_geometry (priv->screen, i, &other);
+      if (other.width == geometry->width && other.height == geometry->height)
+        return i;
+    }
+
+  return monitor_index;
+}
+
 CoglTexture *
 meta_background_get_texture (MetaBackground         *self,
                              int                     monitor_index,
@@ -707,6 +848,7 @@ meta_background_get_texture (MetaBackground         *self,
   MetaRectangle geometry;
   cairo_rectangle_int_t monitor_area;
   CoglTexture *texture1, *texture2;
+  int prerender_index;
 
   g_return_val_if_fail (META_IS_BACKGROUND (self), NULL);
   priv = self->priv;
@@ -745,9 +887,19 @@ meta_background_get_texture (MetaBackground         *self,
       return priv->wallpaper_texture;
     }
 
+  prerender_index = get_prerender_monitor (self, monitor_index, &geometry);
+  if (prerender_index != monitor_index)
+    {
+      /* Drop anything left over from when this monitor had its own texture */
+      free_monitor_fbo (monitor);
+      monitor->dirty = FALSE;
+      monitor = &priv->monitors[prerender_index];
+    }
+
   if (monitor->dirty)
     {
       CoglError *catch_error = NULL;
+      gint64 start_time = g_get_monotonic_time ();
 
       if (monitor->texture == NULL)
         {
@@ -830,6 +982,11 @@ meta_background_get_texture (MetaBackground         *self,
         }
 
       monitor->dirty = FALSE;
+
+      meta_topic (META_DEBUG_COMPOSITOR,
+                  "Prerendered background for monitor %d (%dx%d, blend %.3f) in %" G_GINT64_FORMAT " us\n",
+                  prerender_index, monitor_area.width, monitor_area.height,
+                  priv->blend_factor, g_get_monotonic_time () - start_time);
     }
 
   if (texture_area)
@@ -909,6 +1066,19 @@ meta_background_set_blend (MetaBackground          *self,
 
   priv = self->priv;
 
+  /* During a slideshow transition only the blend factor changes, once
+   * per frame; skip re-blending every monitor until the change becomes
+   * visible, but always render the end points exactly.
+   */
+  if (style == priv->style &&
+      file_equal0 (file1, priv->file1) &&
+      file_equal0 (file2, priv->file2) &&
+      blend_factor != 0.0 && blend_factor != 1.0 &&
+      fabs (blend_factor - priv->blend_factor) < BLEND_FACTOR_STEP)
+    return;
+
+  update_image_max_size (self, style);
+
   set_file (self, &priv->file1, &priv->background_image1, file1);
   set_file (self, &priv->file2, &priv->background_image2, file2);
 
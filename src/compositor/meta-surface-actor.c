@@ -24,6 +24,13 @@ struct _MetaSurfaceActorPrivate
 
   cairo_region_t *input_region;
 
+  /* The input region as (x1, y1, x2, y2) rectangles and the pipeline
+   * used to draw them when picking; kept around since picking happens
+   * for every pointer motion. */
+  float *input_rectangles;
+  int n_input_rectangles;
+  CoglPipeline *pick_pipeline;
+
   /* Freeze/thaw accounting */
   guint needs_damage_all : 1;
   guint frozen : 1;
@@ -58,41 +65,27 @@ meta_surface_actor_pick (ClutterActor       *actor,
   /* If there is no region then use the regular pick */
   if (priv->input_region == NULL)
     CLUTTER_ACTOR_CLASS (meta_surface_actor_parent_class)->pick (actor, color);
-  else
+  else if (priv->n_input_rectangles > 0)
     {
-      int n_rects;
-      float *rectangles;
-      int i;
-      CoglPipeline *pipeline;
-      CoglContext *ctx;
       CoglFramebuffer *fb;
       CoglColor cogl_color;
 
-      n_rects = cairo_region_num_rectangles (priv->input_region);
-      rectangles = g_alloca (sizeof (float) * 4 * n_rects);
-
-      for (i = 0; i < n_rects; i++)
+      if (!priv->pick_pipeline)
         {
-          cairo_rectangle_int_t rect;
-          int pos = i * 4;
-
-          cairo_region_get_rectangle (priv->input_region, i, &rect);
+          CoglContext *ctx =
+            clutter_backend_get_cogl_context (clutter_get_default_backend ());
 
-          rectangles[pos + 0] = rect.x;
-          rectangles[pos + 1] = rect.y;
-          rectangles[pos + 2] = rect.x + rect.width;
-          rectangles[pos + 3] = rect.y + rect.height;
+          priv->pick_pipeline = cogl_pipeline_new (ctx);
         }
 
-      ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
       fb = cogl_get_draw_framebuffer ();
 
       cogl_color_init_from_4ub (&cogl_color, color->red, color->green, color->blue, color->alpha);
+      cogl_pipeline_set_color (priv->pick_pipeline, &cogl_color);
 
-      pipeline = cogl_pipeline_new (ctx);
-      cogl_pipeline_set_color (pipeline, &cogl_color);
-      cogl_framebuffer_draw_rectangles (fb, pipeline, rectangles, n_rects);
-      cogl_object_unref (pipeline);
+      cogl_framebuffer_draw_rectangles (fb, priv->pick_pipeline,
+                                        priv->input_rectangles,
+                                        priv->n_input_rectangles);
     }
 
   clutter_actor_iter_init (&iter, actor);
@@ -108,6 +101,8 @@ meta_surface_actor_dispose (GObject *object)
   MetaSurfaceActorPrivate *priv = self->priv;
 
   g_clear_pointer (&priv->input_region, cairo_region_destroy);
+  g_clear_pointer (&priv->input_rectangles, g_free);
+  g_clear_pointer (&priv->pick_pipeline, cogl_object_unref);
 
   G_OBJECT_CLASS (meta_surface_actor_parent_class)->dispose (object);
 }
@@ -217,14 +212,42 @@ meta_surface_actor_set_input_region (MetaSurfaceActor *self,
                                      cairo_region_t   *region)
 {
   MetaSurfaceActorPrivate *priv = self->priv;
+  int i;
+
+  if (priv->input_region == region ||
+      (priv->input_region && region &&
+       cairo_region_equal (priv->input_region, region)))
+    return;
 
   if (priv->input_region)
     cairo_region_destroy (priv->input_region);
 
+  g_clear_pointer (&priv->input_rectangles, g_free);
+  priv->n_input_rectangles = 0;
+
   if (region)
     priv->input_region = cairo_region_reference (region);
   else
     priv->input_region = NULL;
+
+  if (!priv->input_region)
+    return;
+
+  priv->n_input_rectangles = cairo_region_num_rectangles (priv->input_region);
+  priv->input_rectangles = g_new (float, 4 * priv->n_input_rectangles);
+
+  for (i = 0; i < priv->n_input_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int pos = i * 4;
+
+      cairo_region_get_rectangle (priv->input_region, i, &rect);
+
+      priv->input_rectangles[pos + 0] = rect.x;
+      priv->input_rectangles[pos + 1] = rect.y;
+      priv->input_rectangles[pos + 2] = rect.x + rect.width;
+      priv->input_rectangles[pos + 3] = rect.y + rect.height;
+    }
 }
 
 void
@@ -24,8 +24,9 @@ void meta_window_actor_size_change   (MetaWindowActor *self,
                                       MetaRectangle   *old_frame_rect,
                                       MetaRectangle   *old_buffer_rect);
 
-void meta_window_actor_process_x11_damage (MetaWindowActor    *self,
-                                           XDamageNotifyEvent *event);
+gboolean meta_window_actor_queue_x11_damage (MetaWindowActor    *self,
+                                             XDamageNotifyEvent *event);
+int      meta_window_actor_flush_x11_damage (MetaWindowActor    *self);
 
 void meta_window_actor_pre_paint      (MetaWindowActor    *self);
 void meta_window_actor_post_paint     (MetaWindowActor    *self);
@@ -70,6 +70,8 @@ struct _MetaWindowActorPrivate
   cairo_region_t   *shape_region;
   /* The region we should clip to when painting the shadow */
   cairo_region_t   *shadow_clip;
+  /* X damage received since the last flush, in surface coordinates */
+  cairo_region_t   *pending_x11_damage;
 
   /* Extracted size-invariant shape used for shadows */
   MetaWindowShape  *shadow_shape;
@@ -469,6 +471,7 @@ meta_window_actor_dispose (GObject *object)
 
   g_clear_pointer (&priv->shape_region, cairo_region_destroy);
   g_clear_pointer (&priv->shadow_clip, cairo_region_destroy);
+  g_clear_pointer (&priv->pending_x11_damage, cairo_region_destroy);
 
   g_clear_pointer (&priv->shadow_class, g_free);
   g_clear_pointer (&priv->focused_shadow, meta_shadow_unref);
@@ -1602,18 +1605,82 @@ check_needs_shadow (MetaWindowActor *self)
     meta_shadow_unref (old_shadow);
 }
 
-void
-meta_window_actor_process_x11_damage (MetaWindowActor    *self,
-                                      XDamageNotifyEvent *event)
+/**
+ * meta_window_actor_queue_x11_damage:
+ * @self: a #MetaWindowActor
+ * @event: the damage event
+ *
+ * Accumulates the damaged area without updating the texture yet; the
+ * compositor calls meta_window_actor_flush_x11_damage() once all queued
+ * X events were handled, so clients streaming small damage rectangles
+ * only cost one texture update and redraw per area.
+ *
+ * Returns: %TRUE if the actor had no pending damage before
+ */
+gboolean
+meta_window_actor_queue_x11_damage (MetaWindowActor    *self,
+                                    XDamageNotifyEvent *event)
 {
   MetaWindowActorPrivate *priv = self->priv;
+  cairo_rectangle_int_t rect;
+  gboolean was_empty;
+
+  if (priv->disposed)
+    return FALSE;
+
+  rect.x = event->area.x;
+  rect.y = event->area.y;
+  rect.width = event->area.width;
+  rect.height = event->area.height;
+
+  was_empty = priv->pending_x11_damage == NULL;
+  if (was_empty)
+    priv->pending_x11_damage = cairo_region_create_rectangle (&rect);
+  else
+    cairo_region_union_rectangle (priv->pending_x11_damage, &rect);
+
+  return was_empty;
+}
+
+/**
+ * meta_window_actor_flush_x11_damage:
+ * @self: a #MetaWindowActor
+ *
+ * Processes the damage accumulated by meta_window_actor_queue_x11_damage().
+ *
+ * Returns: the number of rectangles the damage was processed as
+ */
+int
+meta_window_actor_flush_x11_damage (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  cairo_region_t *damage;
+  int i, n_rects;
+
+  damage = priv->pending_x11_damage;
+  priv->pending_x11_damage = NULL;
+
+  if (damage == NULL)
+    return 0;
+
+  n_rects = cairo_region_num_rectangles (damage);
 
   if (priv->surface)
-    meta_surface_actor_process_damage (priv->surface,
-                                       event->area.x,
-                                       event->area.y,
-                                       event->area.width,
-                                       event->area.height);
+    {
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (damage, i, &rect);
+          meta_surface_actor_process_damage (priv->surface,
+                                             rect.x, rect.y,
+                                             rect.width, rect.height);
+        }
+    }
+
+  cairo_region_destroy (damage);
+
+  return n_rects;
 }
 
 void
@@ -89,21 +89,8 @@ lower_window_and_transients (MetaWindow *window,
       if (window->screen->active_workspace &&
           meta_window_located_on_workspace (window,
                                             window->screen->active_workspace))
-        {
-          GList* link;
-          link = g_list_find (window->screen->active_workspace->mru_list,
-                              window);
-          g_assert (link);
-
-          window->screen->active_workspace->mru_list =
-            g_list_remove_link (window->screen->active_workspace->mru_list,
-                                link);
-          g_list_free (link);
-
-          window->screen->active_workspace->mru_list =
-            g_list_append (window->screen->active_workspace->mru_list,
-                           window);
-        }
+        meta_workspace_mru_move_to_back (window->screen->active_workspace,
+                                         window);
     }
 
   return FALSE;
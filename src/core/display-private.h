@@ -145,6 +145,17 @@ struct _MetaDisplay
   /* last user interaction time in any app */
   guint32 last_user_time;
 
+  /* All tracked windows, see meta_display_track_window(). Override
+   * redirect windows are kept apart since most callers skip them; each
+   * window knows its index in its array.
+   */
+  GPtrArray *managed_windows;
+  GPtrArray *override_redirect_windows;
+
+  /* The managed windows again, most recently used (by user time)
+   * first; see meta_display_update_window_mru() */
+  GQueue global_mru_list;
+
   /* whether we're using mousenav (only relevant for sloppy&mouse focus modes;
    * !mouse_mode means "keynav mode")
    */
@@ -370,6 +381,13 @@ void        meta_display_register_wayland_window   (MetaDisplay *display,
 void        meta_display_unregister_wayland_window (MetaDisplay *display,
                                                     MetaWindow  *window);
 
+void        meta_display_track_window      (MetaDisplay *display,
+                                            MetaWindow  *window);
+void        meta_display_untrack_window    (MetaDisplay *display,
+                                            MetaWindow  *window);
+void        meta_display_update_window_mru (MetaDisplay *display,
+                                            MetaWindow  *window);
+
 MetaWindow* meta_display_lookup_sync_alarm     (MetaDisplay *display,
                                                 XSyncAlarm   alarm);
 void        meta_display_register_sync_alarm   (MetaDisplay *display,
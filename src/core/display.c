@@ -41,6 +41,7 @@
 #include <meta/errors.h>
 #include "keybindings-private.h"
 #include <meta/prefs.h>
+#include "prefs-private.h"
 #include "workspace-private.h"
 #include "bell.h"
 #include <meta/compositor.h>
@@ -150,8 +151,8 @@ static const char *net_wm_name = "Mutter";
 
 static void update_cursor_theme (void);
 
-static void    prefs_changed_callback    (MetaPreference pref,
-                                          void          *data);
+static void    prefs_changed_callback    (MetaPrefsChangeSet  changes,
+                                          void               *data);
 
 static int mru_cmp (gconstpointer a,
                     gconstpointer b);
@@ -602,7 +603,7 @@ meta_display_open (void)
 
   meta_display_init_keys (display);
 
-  meta_prefs_add_listener (prefs_changed_callback, display);
+  meta_prefs_add_batch_listener (prefs_changed_callback, display);
 
   meta_verbose ("Creating %d atoms\n", (int) G_N_ELEMENTS (atom_names));
   XInternAtoms (display->xdisplay, atom_names, G_N_ELEMENTS (atom_names),
@@ -646,6 +647,8 @@ meta_display_open (void)
   display->stamps = g_hash_table_new (g_int64_hash,
                                       g_int64_equal);
   display->wayland_windows = g_hash_table_new (NULL, NULL);
+  display->managed_windows = g_ptr_array_new ();
+  display->override_redirect_windows = g_ptr_array_new ();
 
   i = 0;
   while (i < N_IGNORED_CROSSING_SERIALS)
@@ -980,17 +983,6 @@ meta_display_open (void)
   return TRUE;
 }
 
-static gint
-ptrcmp (gconstpointer a, gconstpointer b)
-{
-  if (a < b)
-    return -1;
-  else if (a > b)
-    return 1;
-  else
-    return 0;
-}
-
 /**
  * meta_display_list_windows:
  * @display: a #MetaDisplay
@@ -1007,73 +999,30 @@ meta_display_list_windows (MetaDisplay          *display,
                            MetaListWindowsFlags  flags)
 {
   GSList *winlist;
-  GSList *prev;
-  GSList *tmp;
-  GHashTableIter iter;
-  gpointer key, value;
+  GList *l;
+  guint i;
 
   winlist = NULL;
 
-  g_hash_table_iter_init (&iter, display->xids);
-  while (g_hash_table_iter_next (&iter, &key, &value))
+  /* The global MRU list already has the managed windows in order */
+  if ((flags & META_LIST_SORTED) &&
+      (flags & META_LIST_INCLUDE_OVERRIDE_REDIRECT) == 0)
     {
-      MetaWindow *window = value;
+      for (l = display->global_mru_list.tail; l != NULL; l = l->prev)
+        winlist = g_slist_prepend (winlist, l->data);
 
-      if (!META_IS_WINDOW (window) || window->unmanaging)
-        continue;
-
-      if (!window->override_redirect ||
-          (flags & META_LIST_INCLUDE_OVERRIDE_REDIRECT) != 0)
-        winlist = g_slist_prepend (winlist, window);
+      return winlist;
     }
 
-  g_hash_table_iter_init (&iter, display->wayland_windows);
-  while (g_hash_table_iter_next (&iter, &key, &value))
-    {
-      MetaWindow *window = value;
+  for (i = 0; i < display->managed_windows->len; i++)
+    winlist = g_slist_prepend (winlist,
+                               g_ptr_array_index (display->managed_windows, i));
 
-      if (!META_IS_WINDOW (window) || window->unmanaging)
-        continue;
-
-      if (!window->override_redirect ||
-          (flags & META_LIST_INCLUDE_OVERRIDE_REDIRECT) != 0)
-        winlist = g_slist_prepend (winlist, window);
-    }
-
-  /* Uniquify the list, since both frame windows and plain
-   * windows are in the hash
-   */
-  winlist = g_slist_sort (winlist, ptrcmp);
-
-  prev = NULL;
-  tmp = winlist;
-  while (tmp != NULL)
+  if (flags & META_LIST_INCLUDE_OVERRIDE_REDIRECT)
     {
-      GSList *next;
-
-      next = tmp->next;
-
-      if (next &&
-          next->data == tmp->data)
-        {
-          /* Delete tmp from list */
-
-          if (prev)
-            prev->next = next;
-
-          if (tmp == winlist)
-            winlist = next;
-
-          g_slist_free_1 (tmp);
-
-          /* leave prev unchanged */
-        }
-      else
-        {
-          prev = tmp;
-        }
-
-      tmp = next;
+      for (i = 0; i < display->override_redirect_windows->len; i++)
+        winlist = g_slist_prepend (winlist,
+                                   g_ptr_array_index (display->override_redirect_windows, i));
     }
 
   if (flags & META_LIST_SORTED)
@@ -1097,7 +1046,7 @@ meta_display_close (MetaDisplay *display,
 
   display->closing += 1;
 
-  meta_prefs_remove_listener (prefs_changed_callback, display);
+  meta_prefs_remove_batch_listener (prefs_changed_callback, display);
 
   meta_display_remove_autoraise_callback (display);
 
@@ -1126,6 +1075,8 @@ meta_display_close (MetaDisplay *display,
    */
   g_hash_table_destroy (display->xids);
   g_hash_table_destroy (display->wayland_windows);
+  g_ptr_array_free (display->managed_windows, TRUE);
+  g_ptr_array_free (display->override_redirect_windows, TRUE);
 
   if (display->leader_window != None)
     XDestroyWindow (display->xdisplay, display->leader_window);
@@ -1604,6 +1555,92 @@ meta_display_unregister_wayland_window (MetaDisplay *display,
   g_hash_table_remove (display->wayland_windows, window);
 }
 
+/* Puts window at its place in the global MRU list according to its
+ * user time. Updates almost always make the window the most recently
+ * used one, so the search for its place starts from the front.
+ */
+void
+meta_display_update_window_mru (MetaDisplay *display,
+                                MetaWindow  *window)
+{
+  guint32 user_time = meta_window_get_user_time (window);
+  GList *link = &window->global_mru_link;
+  GList *l;
+
+  if (link->data != NULL)
+    g_queue_unlink (&display->global_mru_list, link);
+
+  link->data = window;
+
+  for (l = display->global_mru_list.head; l != NULL; l = l->next)
+    {
+      if (meta_window_get_user_time (l->data) <= user_time)
+        break;
+    }
+
+  if (l == NULL)
+    g_queue_push_tail_link (&display->global_mru_list, link);
+  else if (l->prev == NULL)
+    g_queue_push_head_link (&display->global_mru_list, link);
+  else
+    {
+      link->prev = l->prev;
+      link->next = l;
+      l->prev->next = link;
+      l->prev = link;
+      display->global_mru_list.length++;
+    }
+}
+
+static GPtrArray *
+get_window_registry (MetaDisplay *display,
+                     MetaWindow  *window)
+{
+  if (window->override_redirect)
+    return display->override_redirect_windows;
+  else
+    return display->managed_windows;
+}
+
+/* Adds window to the windows listed by meta_display_list_windows(),
+ * and to the global MRU list if it is managed.
+ */
+void
+meta_display_track_window (MetaDisplay *display,
+                           MetaWindow  *window)
+{
+  GPtrArray *windows = get_window_registry (display, window);
+
+  window->registry_index = windows->len;
+  g_ptr_array_add (windows, window);
+
+  if (!window->override_redirect)
+    meta_display_update_window_mru (display, window);
+}
+
+void
+meta_display_untrack_window (MetaDisplay *display,
+                             MetaWindow  *window)
+{
+  GPtrArray *windows = get_window_registry (display, window);
+  MetaWindow *last;
+
+  if (window->registry_index >= windows->len ||
+      g_ptr_array_index (windows, window->registry_index) != window)
+    return;
+
+  /* Keep the array dense by moving the last window into the hole */
+  last = g_ptr_array_index (windows, windows->len - 1);
+  last->registry_index = window->registry_index;
+  g_ptr_array_remove_index_fast (windows, window->registry_index);
+
+  if (window->global_mru_link.data != NULL)
+    {
+      g_queue_unlink (&display->global_mru_list, &window->global_mru_link);
+      window->global_mru_link.data = NULL;
+    }
+}
+
 MetaWindow*
 meta_display_lookup_stamp (MetaDisplay *display,
                            guint64       stamp)
@@ -2356,7 +2393,7 @@ find_tab_forward (MetaDisplay   *display,
       tmp = tmp->next;
     }
 
-  tmp = workspace->mru_list;
+  tmp = workspace->mru_list.head;
   while (tmp != start)
     {
       MetaWindow *window = tmp->data;
@@ -2395,7 +2432,7 @@ find_tab_backward (MetaDisplay   *display,
       tmp = tmp->prev;
     }
 
-  tmp = g_list_last (workspace->mru_list);
+  tmp = workspace->mru_list.tail;
   while (tmp != start)
     {
       MetaWindow *window = tmp->data;
@@ -2446,20 +2483,9 @@ meta_display_get_tab_list (MetaDisplay   *display,
                            MetaWorkspace *workspace)
 {
   GList *tab_list = NULL;
-  GList *global_mru_list = NULL;
   GList *mru_list, *tmp;
-  GSList *windows = meta_display_list_windows (display, META_LIST_DEFAULT);
-  GSList *w;
-
-  if (workspace == NULL)
-    {
-      /* Yay for mixing GList and GSList in the API */
-      for (w = windows; w; w = w->next)
-        global_mru_list = g_list_prepend (global_mru_list, w->data);
-      global_mru_list = g_list_sort (global_mru_list, mru_cmp);
-    }
 
-  mru_list = workspace ? workspace->mru_list : global_mru_list;
+  mru_list = workspace ? workspace->mru_list.head : display->global_mru_list.head;
 
   /* Windows sellout mode - MRU order. Collect unminimized windows
    * then minimized so minimized windows aren't in the way so much.
@@ -2486,9 +2512,9 @@ meta_display_get_tab_list (MetaDisplay   *display,
    * other workspaces that demand attention
    */
   if (workspace)
-    for (w = windows; w; w = w->next)
+    for (tmp = display->global_mru_list.head; tmp; tmp = tmp->next)
       {
-        MetaWindow *l_window = w->data;
+        MetaWindow *l_window = tmp->data;
 
         if (l_window->wm_state_demands_attention &&
             l_window->workspace != workspace &&
@@ -2496,9 +2522,6 @@ meta_display_get_tab_list (MetaDisplay   *display,
           tab_list = g_list_prepend (tab_list, l_window);
       }
 
-  g_list_free (global_mru_list);
-  g_slist_free (windows);
-
   return tab_list;
 }
 
@@ -2714,12 +2737,12 @@ meta_display_sort_windows_by_stacking (MetaDisplay *display,
 }
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        void          *data)
+prefs_changed_callback (MetaPrefsChangeSet  changes,
+                        void               *data)
 {
   MetaDisplay *display = data;
 
-  if (pref == META_PREF_FOCUS_MODE)
+  if (META_PREFS_CHANGE_SET_HAS (changes, META_PREF_FOCUS_MODE))
     {
       GSList *windows, *l;
       windows = meta_display_list_windows (display, META_LIST_DEFAULT);
@@ -2734,12 +2757,15 @@ prefs_changed_callback (MetaPreference pref,
 
       g_slist_free (windows);
     }
-  else if (pref == META_PREF_AUDIBLE_BELL)
+
+  if (META_PREFS_CHANGE_SET_HAS (changes, META_PREF_AUDIBLE_BELL))
     {
       meta_bell_set_audible (display, meta_prefs_bell_is_audible ());
     }
-  else if (pref == META_PREF_CURSOR_THEME ||
-           pref == META_PREF_CURSOR_SIZE)
+
+  /* Theme and size usually change together; reload the cursors once */
+  if (META_PREFS_CHANGE_SET_HAS (changes, META_PREF_CURSOR_THEME) ||
+      META_PREFS_CHANGE_SET_HAS (changes, META_PREF_CURSOR_SIZE))
     {
       update_cursor_theme ();
     }
@@ -27,6 +27,7 @@
 
 #include "display-private.h"
 #include "window-private.h"
+#include "meta-input-latency-private.h"
 #include "backends/x11/meta-backend-x11.h"
 #include "backends/meta-cursor-tracker-private.h"
 
@@ -171,6 +172,9 @@ meta_display_handle_event (MetaDisplay        *display,
   MetaGestureTracker *tracker;
   ClutterEventSequence *sequence;
   ClutterInputDevice *source;
+  MetaInputLatencyTrace trace;
+
+  meta_input_latency_begin (&trace, event);
 
   sequence = clutter_event_get_event_sequence (event);
 
@@ -309,6 +313,8 @@ meta_display_handle_event (MetaDisplay        *display,
     }
 
  out:
+  meta_input_latency_mark (&trace, META_INPUT_LATENCY_STAGE_DISPATCHED);
+
   /* If the compositor has a grab, don't pass that through to Wayland */
   if (display->event_route == META_EVENT_ROUTE_COMPOSITOR_GRAB)
     bypass_wayland = TRUE;
@@ -322,6 +328,8 @@ meta_display_handle_event (MetaDisplay        *display,
     {
       if (meta_wayland_compositor_handle_event (compositor, event))
         bypass_clutter = TRUE;
+
+      meta_input_latency_mark (&trace, META_INPUT_LATENCY_STAGE_DELIVERED);
     }
 #endif
 
@@ -346,6 +354,8 @@ event_callback (const ClutterEvent *event,
 void
 meta_display_init_events (MetaDisplay *display)
 {
+  meta_input_latency_init ();
+
   display->clutter_event_filter = clutter_event_add_filter (NULL,
                                                             event_callback,
                                                             NULL,
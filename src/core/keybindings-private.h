@@ -48,6 +48,14 @@ typedef struct _MetaResolvedKeyCombo {
   xkb_mod_mask_t mask;
 } MetaResolvedKeyCombo;
 
+/* One entry of the keysym -> keycode table derived from the keymap */
+typedef struct _MetaKeysymKeycode {
+  xkb_keysym_t keysym;
+  xkb_layout_index_t layout;
+  xkb_level_index_t level;
+  xkb_keycode_t keycode;
+} MetaKeysymKeycode;
+
 /**
  * MetaKeyCombo:
  * @keysym: keysym
@@ -104,6 +112,14 @@ typedef struct
 
   xkb_level_index_t keymap_num_levels;
 
+  /* Sorted by keysym, then layout, level and keycode; rebuilt only
+   * when the keymap changes. */
+  MetaKeysymKeycode *keysym_keycodes;
+  int n_keysym_keycodes;
+
+  /* Number of XI key grab/ungrab requests issued so far */
+  guint n_keygrab_requests;
+
   /* Alt+click button grabs */
   ClutterModifierType window_grab_modifiers;
 } MetaKeyBindingManager;
@@ -132,8 +132,17 @@ static gboolean process_keyboard_resize_grab (MetaDisplay     *display,
                                               MetaWindow      *window,
                                               ClutterKeyEvent *event);
 
-static void grab_key_bindings           (MetaDisplay *display);
-static void ungrab_key_bindings         (MetaDisplay *display);
+typedef struct
+{
+  GArray *global_combos;
+  GArray *window_combos;
+  xkb_mod_mask_t ignored_modifier_mask;
+} MetaKeyGrabSnapshot;
+
+static void snapshot_key_grabs          (MetaKeyBindingManager *keys,
+                                         MetaKeyGrabSnapshot   *snapshot);
+static void update_key_grabs            (MetaDisplay           *display,
+                                         MetaKeyGrabSnapshot   *old_snapshot);
 
 static GHashTable *key_handlers;
 static GHashTable *external_grabs;
@@ -228,47 +237,119 @@ reload_modmap (MetaKeyBindingManager *keys)
               keys->meta_mask);
 }
 
-static gboolean
-is_keycode_for_keysym (struct xkb_keymap *keymap,
-                       xkb_layout_index_t layout,
-                       xkb_level_index_t  level,
-                       xkb_keycode_t      keycode,
-                       xkb_keysym_t       keysym)
+static int
+compare_keysym_keycodes (gconstpointer a,
+                         gconstpointer b)
 {
-  const xkb_keysym_t *syms;
-  int num_syms, k;
+  const MetaKeysymKeycode *entry_a = a;
+  const MetaKeysymKeycode *entry_b = b;
+
+  if (entry_a->keysym != entry_b->keysym)
+    return entry_a->keysym < entry_b->keysym ? -1 : 1;
+  if (entry_a->layout != entry_b->layout)
+    return entry_a->layout < entry_b->layout ? -1 : 1;
+  if (entry_a->level != entry_b->level)
+    return entry_a->level < entry_b->level ? -1 : 1;
+  if (entry_a->keycode != entry_b->keycode)
+    return entry_a->keycode < entry_b->keycode ? -1 : 1;
+
+  return 0;
+}
+
+typedef struct
+{
+  GArray *entries;
+  xkb_layout_index_t num_layouts;
+  xkb_level_index_t num_levels;
+} BuildKeysymTableData;
+
+static void
+build_keysym_table_iter (struct xkb_keymap *keymap,
+                         xkb_keycode_t      keycode,
+                         void              *data)
+{
+  BuildKeysymTableData *build_data = data;
+  xkb_layout_index_t i;
+  xkb_level_index_t j;
+
+  /* Query all layouts of the keymap rather than the ones of the key,
+   * xkbcommon wraps out of range layouts per key the same way the X
+   * server does when resolving keysyms. */
+  for (i = 0; i < build_data->num_layouts; i++)
+    for (j = 0; j < build_data->num_levels; j++)
+      {
+        const xkb_keysym_t *syms;
+        int num_syms, k;
+
+        num_syms = xkb_keymap_key_get_syms_by_level (keymap, keycode, i, j, &syms);
+        for (k = 0; k < num_syms; k++)
+          {
+            MetaKeysymKeycode entry = { syms[k], i, j, keycode };
+            g_array_append_val (build_data->entries, entry);
+          }
+      }
+}
+
+/* Walk the keymap once and store every (keysym, keycode) pair in a
+ * sorted array, so that resolving the keysyms of all bindings doesn't
+ * need to walk the whole keymap for each of them. */
+static void
+reload_keysym_table (MetaKeyBindingManager *keys)
+{
+  MetaBackend *backend = meta_get_backend ();
+  struct xkb_keymap *keymap = meta_backend_get_keymap (backend);
+  BuildKeysymTableData build_data;
+  MetaKeysymKeycode *entries;
+  guint i, n_entries;
 
-  num_syms = xkb_keymap_key_get_syms_by_level (keymap, keycode, layout, level, &syms);
-  for (k = 0; k < num_syms; k++)
+  build_data.entries = g_array_new (FALSE, FALSE, sizeof (MetaKeysymKeycode));
+  build_data.num_layouts = xkb_keymap_num_layouts (keymap);
+  build_data.num_levels = keys->keymap_num_levels;
+
+  xkb_keymap_key_for_each (keymap, build_keysym_table_iter, &build_data);
+
+  g_array_sort (build_data.entries, compare_keysym_keycodes);
+
+  /* A keysym can appear more than once on the same level of a key */
+  entries = (MetaKeysymKeycode *) build_data.entries->data;
+  n_entries = 0;
+  for (i = 0; i < build_data.entries->len; i++)
     {
-      if (syms[k] == keysym)
-        return TRUE;
+      if (n_entries > 0 &&
+          compare_keysym_keycodes (&entries[n_entries - 1], &entries[i]) == 0)
+        continue;
+
+      entries[n_entries++] = entries[i];
     }
 
-  return FALSE;
+  g_free (keys->keysym_keycodes);
+  keys->n_keysym_keycodes = n_entries;
+  keys->keysym_keycodes = (MetaKeysymKeycode *) g_array_free (build_data.entries, FALSE);
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "Keymap has %d keysym/keycode pairs in %d layouts\n",
+              keys->n_keysym_keycodes, build_data.num_layouts);
 }
 
-typedef struct
+/* Returns the index of the first entry for @keysym in the keysym table,
+ * or the index it would be inserted at if there is none */
+static int
+find_keysym_table_index (MetaKeyBindingManager *keys,
+                         xkb_keysym_t           keysym)
 {
-  GArray *keycodes;
-  xkb_keysym_t keysym;
-  xkb_layout_index_t layout;
-  xkb_level_index_t level;
-} FindKeysymData;
+  int low = 0, high = keys->n_keysym_keycodes;
 
-static void
-get_keycodes_for_keysym_iter (struct xkb_keymap *keymap,
-                              xkb_keycode_t      keycode,
-                              void              *data)
-{
-  FindKeysymData *search_data = data;
-  GArray *keycodes = search_data->keycodes;
-  xkb_keysym_t keysym = search_data->keysym;
-  xkb_layout_index_t layout = search_data->layout;
-  xkb_level_index_t level = search_data->level;
+  while (low < high)
+    {
+      int mid = low + (high - low) / 2;
 
-  if (is_keycode_for_keysym (keymap, layout, level, keycode, keysym))
-    g_array_append_val (keycodes, keycode);
+      if (keys->keysym_keycodes[mid].keysym < keysym)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
 }
 
 /* Original code from gdk_x11_keymap_get_entries_for_keyval() in
@@ -281,6 +362,7 @@ get_keycodes_for_keysym (MetaKeyBindingManager  *keys,
   GArray *retval;
   int n_keycodes;
   int keycode;
+  int i;
 
   retval = g_array_new (FALSE, FALSE, sizeof (int));
 
@@ -292,19 +374,13 @@ get_keycodes_for_keysym (MetaKeyBindingManager  *keys,
       goto out;
     }
 
-  {
-    MetaBackend *backend = meta_get_backend ();
-    struct xkb_keymap *keymap = meta_backend_get_keymap (backend);
-    xkb_layout_index_t i;
-    xkb_level_index_t j;
-
-    for (i = 0; i < xkb_keymap_num_layouts (keymap); i++)
-      for (j = 0; j < keys->keymap_num_levels; j++)
-        {
-          FindKeysymData search_data = { retval, keysym, i, j };
-          xkb_keymap_key_for_each (keymap, get_keycodes_for_keysym_iter, &search_data);
-        }
-  }
+  for (i = find_keysym_table_index (keys, keysym);
+       i < keys->n_keysym_keycodes && keys->keysym_keycodes[i].keysym == (xkb_keysym_t) keysym;
+       i++)
+    {
+      keycode = keys->keysym_keycodes[i].keycode;
+      g_array_append_val (retval, keycode);
+    }
 
  out:
   n_keycodes = retval->len;
@@ -316,19 +392,16 @@ static guint
 get_first_keycode_for_keysym (MetaKeyBindingManager *keys,
                               guint                  keysym)
 {
-  int *keycodes;
-  int n_keycodes;
-  int keycode;
+  int i;
 
-  n_keycodes = get_keycodes_for_keysym (keys, keysym, &keycodes);
+  if (keysym == META_KEY_ABOVE_TAB)
+    return KEY_GRAVE + 8;
 
-  if (n_keycodes > 0)
-    keycode = keycodes[0];
-  else
-    keycode = 0;
+  i = find_keysym_table_index (keys, keysym);
+  if (i < keys->n_keysym_keycodes && keys->keysym_keycodes[i].keysym == keysym)
+    return keys->keysym_keycodes[i].keycode;
 
-  g_free (keycodes);
-  return keycode;
+  return 0;
 }
 
 static void
@@ -357,6 +430,13 @@ determine_keymap_num_levels (MetaKeyBindingManager *keys)
   xkb_keymap_key_for_each (keymap, determine_keymap_num_levels_iter, &keys->keymap_num_levels);
 }
 
+static void
+reload_keymap (MetaKeyBindingManager *keys)
+{
+  determine_keymap_num_levels (keys);
+  reload_keysym_table (keys);
+}
+
 static void
 reload_iso_next_group_combos (MetaKeyBindingManager *keys)
 {
@@ -548,8 +628,6 @@ reload_combos (MetaKeyBindingManager *keys)
 {
   g_hash_table_remove_all (keys->key_bindings_index);
 
-  determine_keymap_num_levels (keys);
-
   resolve_key_combo (keys,
                      &keys->overlay_key_combo,
                      &keys->overlay_resolved_key_combo);
@@ -647,40 +725,6 @@ rebuild_special_bindings (MetaKeyBindingManager *keys)
   keys->overlay_key_combo = combo;
 }
 
-static void
-ungrab_key_bindings (MetaDisplay *display)
-{
-  GSList *windows, *l;
-
-  meta_screen_ungrab_keys (display->screen);
-
-  windows = meta_display_list_windows (display, META_LIST_DEFAULT);
-  for (l = windows; l; l = l->next)
-    {
-      MetaWindow *w = l->data;
-      meta_window_ungrab_keys (w);
-    }
-
-  g_slist_free (windows);
-}
-
-static void
-grab_key_bindings (MetaDisplay *display)
-{
-  GSList *windows, *l;
-
-  meta_screen_grab_keys (display->screen);
-
-  windows = meta_display_list_windows (display, META_LIST_DEFAULT);
-  for (l = windows; l; l = l->next)
-    {
-      MetaWindow *w = l->data;
-      meta_window_grab_keys (w);
-    }
-
-  g_slist_free (windows);
-}
-
 static MetaKeyBinding *
 get_keybinding (MetaKeyBindingManager *keys,
                 MetaResolvedKeyCombo  *resolved_combo)
@@ -876,17 +920,24 @@ on_keymap_changed (MetaBackend *backend,
 {
   MetaDisplay *display = user_data;
   MetaKeyBindingManager *keys = &display->key_binding_manager;
+  MetaKeyGrabSnapshot old_grabs;
+  gint64 start_time = g_get_monotonic_time ();
 
-  ungrab_key_bindings (display);
+  snapshot_key_grabs (keys, &old_grabs);
 
   /* Deciphering the modmap depends on the loaded keysyms to find out
    * what modifiers is Super and so forth, so we need to reload it
    * even when only the keymap changes */
   reload_modmap (keys);
 
+  reload_keymap (keys);
   reload_combos (keys);
 
-  grab_key_bindings (display);
+  update_key_grabs (display, &old_grabs);
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "Keymap change handled in %" G_GINT64_FORMAT " us\n",
+              g_get_monotonic_time () - start_time);
 }
 
 static void
@@ -1101,11 +1152,15 @@ prefs_changed_callback (MetaPreference pref,
   switch (pref)
     {
     case META_PREF_KEYBINDINGS:
-      ungrab_key_bindings (display);
-      rebuild_key_binding_table (keys);
-      rebuild_special_bindings (keys);
-      reload_combos (keys);
-      grab_key_bindings (display);
+      {
+        MetaKeyGrabSnapshot old_grabs;
+
+        snapshot_key_grabs (keys, &old_grabs);
+        rebuild_key_binding_table (keys);
+        rebuild_special_bindings (keys);
+        reload_combos (keys);
+        update_key_grabs (display, &old_grabs);
+      }
       break;
     case META_PREF_MOUSE_BUTTON_MODS:
       {
@@ -1144,16 +1199,22 @@ meta_display_shutdown_keys (MetaDisplay *display)
 
   g_hash_table_destroy (keys->key_bindings_index);
   g_hash_table_destroy (keys->key_bindings);
+
+  g_clear_pointer (&keys->keysym_keycodes, g_free);
+  keys->n_keysym_keycodes = 0;
 }
 
 /* Grab/ungrab, ignoring all annoying modifiers like NumLock etc. */
 static void
-meta_change_keygrab (MetaKeyBindingManager *keys,
-                     Window                 xwindow,
-                     gboolean               grab,
-                     MetaResolvedKeyCombo  *resolved_combo)
+change_keygrab_with_ignored_mask (MetaKeyBindingManager *keys,
+                                  Window                 xwindow,
+                                  gboolean               grab,
+                                  MetaResolvedKeyCombo  *resolved_combo,
+                                  xkb_mod_mask_t         ignored_modifier_mask)
 {
   unsigned int ignored_mask;
+  XIGrabModifiers mods[256];
+  int n_mods;
 
   unsigned char mask_bits[XIMaskLen (XI_LASTEVENT)] = { 0 };
   XIEventMask mask = { XIAllMasterDevices, sizeof (mask_bits), mask_bits };
@@ -1166,7 +1227,8 @@ meta_change_keygrab (MetaKeyBindingManager *keys,
 
   /* Grab keycode/modmask, together with
    * all combinations of ignored modifiers.
-   * X provides no better way to do this.
+   * X provides no better way to do this, but at least
+   * all the combinations fit into a single request.
    */
 
   meta_topic (META_DEBUG_KEYBINDINGS,
@@ -1174,12 +1236,15 @@ meta_change_keygrab (MetaKeyBindingManager *keys,
               grab ? "Grabbing" : "Ungrabbing",
               resolved_combo->keycode, resolved_combo->mask, xwindow);
 
+  /* Only the lower 8 bits are real X modifiers, so there are at
+   * most 256 combinations. */
+  ignored_modifier_mask &= 0xff;
+
+  n_mods = 0;
   ignored_mask = 0;
-  while (ignored_mask <= keys->ignored_modifier_mask)
+  while (ignored_mask <= ignored_modifier_mask)
     {
-      XIGrabModifiers mods;
-
-      if (ignored_mask & ~(keys->ignored_modifier_mask))
+      if (ignored_mask & ~(ignored_modifier_mask))
         {
           /* Not a combination of ignored modifiers
            * (it contains some non-ignored modifiers)
@@ -1188,88 +1253,263 @@ meta_change_keygrab (MetaKeyBindingManager *keys,
           continue;
         }
 
-      mods = (XIGrabModifiers) { resolved_combo->mask | ignored_mask, 0 };
-
-      if (grab)
-        XIGrabKeycode (xdisplay,
-                       META_VIRTUAL_CORE_KEYBOARD_ID,
-                       resolved_combo->keycode, xwindow,
-                       XIGrabModeSync, XIGrabModeAsync,
-                       False, &mask, 1, &mods);
-      else
-        XIUngrabKeycode (xdisplay,
-                         META_VIRTUAL_CORE_KEYBOARD_ID,
-                         resolved_combo->keycode, xwindow, 1, &mods);
+      mods[n_mods++] = (XIGrabModifiers) { resolved_combo->mask | ignored_mask, 0 };
 
       ++ignored_mask;
     }
+
+  if (grab)
+    XIGrabKeycode (xdisplay,
+                   META_VIRTUAL_CORE_KEYBOARD_ID,
+                   resolved_combo->keycode, xwindow,
+                   XIGrabModeSync, XIGrabModeAsync,
+                   False, &mask, n_mods, mods);
+  else
+    XIUngrabKeycode (xdisplay,
+                     META_VIRTUAL_CORE_KEYBOARD_ID,
+                     resolved_combo->keycode, xwindow, n_mods, mods);
+
+  keys->n_keygrab_requests++;
 }
 
-typedef struct
+static void
+meta_change_keygrab (MetaKeyBindingManager *keys,
+                     Window                 xwindow,
+                     gboolean               grab,
+                     MetaResolvedKeyCombo  *resolved_combo)
+{
+  change_keygrab_with_ignored_mask (keys, xwindow, grab, resolved_combo,
+                                    keys->ignored_modifier_mask);
+}
+
+static int
+compare_resolved_combos (gconstpointer a,
+                         gconstpointer b)
 {
-  MetaKeyBindingManager *keys;
-  Window xwindow;
-  gboolean only_per_window;
-  gboolean grab;
-} ChangeKeygrabData;
+  const MetaResolvedKeyCombo *combo_a = a;
+  const MetaResolvedKeyCombo *combo_b = b;
+
+  if (combo_a->keycode != combo_b->keycode)
+    return combo_a->keycode < combo_b->keycode ? -1 : 1;
+  if (combo_a->mask != combo_b->mask)
+    return combo_a->mask < combo_b->mask ? -1 : 1;
+
+  return 0;
+}
 
 static void
-change_keygrab_foreach (gpointer key,
-                        gpointer value,
-                        gpointer user_data)
+add_grab_combo (GArray               *combos,
+                MetaResolvedKeyCombo *resolved_combo)
 {
-  ChangeKeygrabData *data = user_data;
-  MetaKeyBinding *binding = value;
-  gboolean binding_is_per_window = (binding->flags & META_KEY_BINDING_PER_WINDOW) != 0;
+  if (resolved_combo->keycode != 0)
+    g_array_append_val (combos, *resolved_combo);
+}
 
-  if (data->only_per_window != binding_is_per_window)
-    return;
+/* Returns the sorted set of combos that need to be grabbed either on
+ * the root window or on each (non-dock) toplevel. Several bindings may
+ * resolve to the same combo; those are only grabbed once. */
+static GArray *
+get_grab_combos (MetaKeyBindingManager *keys,
+                 gboolean               only_per_window)
+{
+  GArray *combos;
+  GHashTableIter iter;
+  gpointer value;
+  MetaResolvedKeyCombo *data;
+  guint i, n_unique;
 
-  if (binding->resolved_combo.keycode == 0)
-    return;
+  combos = g_array_new (FALSE, FALSE, sizeof (MetaResolvedKeyCombo));
+
+  if (!only_per_window)
+    {
+      int j;
+
+      add_grab_combo (combos, &keys->overlay_resolved_key_combo);
+
+      for (j = 0; j < keys->n_iso_next_group_combos; j++)
+        add_grab_combo (combos, &keys->iso_next_group_combos[j]);
+    }
 
-  meta_change_keygrab (data->keys, data->xwindow, data->grab, &binding->resolved_combo);
+  g_hash_table_iter_init (&iter, keys->key_bindings);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      MetaKeyBinding *binding = value;
+      gboolean binding_is_per_window = (binding->flags & META_KEY_BINDING_PER_WINDOW) != 0;
+
+      if (only_per_window != binding_is_per_window)
+        continue;
+
+      add_grab_combo (combos, &binding->resolved_combo);
+    }
+
+  g_array_sort (combos, compare_resolved_combos);
+
+  data = (MetaResolvedKeyCombo *) combos->data;
+  n_unique = 0;
+  for (i = 0; i < combos->len; i++)
+    {
+      if (n_unique > 0 &&
+          compare_resolved_combos (&data[n_unique - 1], &data[i]) == 0)
+        continue;
+
+      data[n_unique++] = data[i];
+    }
+  g_array_set_size (combos, n_unique);
+
+  return combos;
 }
 
 static void
-change_binding_keygrabs (MetaKeyBindingManager *keys,
-                         Window                  xwindow,
-                         gboolean                only_per_window,
-                         gboolean                grab)
+change_keygrabs (MetaKeyBindingManager *keys,
+                 Window                 xwindow,
+                 gboolean               grab,
+                 GArray                *combos)
 {
-  ChangeKeygrabData data;
+  guint i;
 
-  data.keys = keys;
-  data.xwindow = xwindow;
-  data.only_per_window = only_per_window;
-  data.grab = grab;
+  for (i = 0; i < combos->len; i++)
+    meta_change_keygrab (keys, xwindow, grab,
+                         &g_array_index (combos, MetaResolvedKeyCombo, i));
+}
 
-  g_hash_table_foreach (keys->key_bindings, change_keygrab_foreach, &data);
+/* Moves the grabs on @xwindow from @old_combos to @new_combos, only
+ * touching the combos that differ between both sorted sets. */
+static void
+diff_keygrabs (MetaKeyBindingManager *keys,
+               Window                 xwindow,
+               GArray                *old_combos,
+               xkb_mod_mask_t         old_ignored_modifier_mask,
+               GArray                *new_combos)
+{
+  guint i, j;
+
+  if (old_ignored_modifier_mask != keys->ignored_modifier_mask)
+    {
+      for (i = 0; i < old_combos->len; i++)
+        change_keygrab_with_ignored_mask (keys, xwindow, FALSE,
+                                          &g_array_index (old_combos, MetaResolvedKeyCombo, i),
+                                          old_ignored_modifier_mask);
+      change_keygrabs (keys, xwindow, TRUE, new_combos);
+      return;
+    }
+
+  i = j = 0;
+  while (i < old_combos->len || j < new_combos->len)
+    {
+      MetaResolvedKeyCombo *old_combo = NULL, *new_combo = NULL;
+      int cmp;
+
+      if (i < old_combos->len)
+        old_combo = &g_array_index (old_combos, MetaResolvedKeyCombo, i);
+      if (j < new_combos->len)
+        new_combo = &g_array_index (new_combos, MetaResolvedKeyCombo, j);
+
+      if (old_combo == NULL)
+        cmp = 1;
+      else if (new_combo == NULL)
+        cmp = -1;
+      else
+        cmp = compare_resolved_combos (old_combo, new_combo);
+
+      if (cmp < 0)
+        {
+          meta_change_keygrab (keys, xwindow, FALSE, old_combo);
+          i++;
+        }
+      else if (cmp > 0)
+        {
+          meta_change_keygrab (keys, xwindow, TRUE, new_combo);
+          j++;
+        }
+      else
+        {
+          i++;
+          j++;
+        }
+    }
 }
 
 static void
-meta_screen_change_keygrabs (MetaScreen *screen,
-                             gboolean    grab)
+snapshot_key_grabs (MetaKeyBindingManager *keys,
+                    MetaKeyGrabSnapshot   *snapshot)
+{
+  snapshot->global_combos = get_grab_combos (keys, FALSE);
+  snapshot->window_combos = get_grab_combos (keys, TRUE);
+  snapshot->ignored_modifier_mask = keys->ignored_modifier_mask;
+}
+
+static Window
+get_window_keygrab_xwindow (MetaWindow *window)
+{
+  if (!window->keys_grabbed)
+    return None;
+
+  if (!window->grab_on_frame)
+    return window->xwindow;
+  else if (window->frame != NULL)
+    return window->frame->xwindow;
+  else
+    return None;
+}
+
+/* Brings the installed grabs in line with the current binding table,
+ * given what it looked like when the grabs were installed. Rather than
+ * ungrabbing and regrabbing everything, only changed combos are
+ * re-grabbed, each with a single request covering all the ignored
+ * modifier variants. */
+static void
+update_key_grabs (MetaDisplay         *display,
+                  MetaKeyGrabSnapshot *old_snapshot)
 {
-  MetaDisplay *display = screen->display;
   MetaKeyBindingManager *keys = &display->key_binding_manager;
+  MetaKeyGrabSnapshot new_snapshot;
+  GSList *windows, *l;
+  guint n_requests = keys->n_keygrab_requests;
 
-  if (keys->overlay_resolved_key_combo.keycode != 0)
-    meta_change_keygrab (keys, screen->xroot, grab, &keys->overlay_resolved_key_combo);
+  snapshot_key_grabs (keys, &new_snapshot);
 
-  if (keys->iso_next_group_combos)
+  if (display->screen->keys_grabbed)
+    diff_keygrabs (keys, display->screen->xroot,
+                   old_snapshot->global_combos,
+                   old_snapshot->ignored_modifier_mask,
+                   new_snapshot.global_combos);
+
+  windows = meta_display_list_windows (display, META_LIST_DEFAULT);
+  for (l = windows; l; l = l->next)
     {
-      int i = 0;
-      while (i < keys->n_iso_next_group_combos)
-        {
-          if (keys->iso_next_group_combos[i].keycode != 0)
-            meta_change_keygrab (keys, screen->xroot, grab, &keys->iso_next_group_combos[i]);
+      MetaWindow *w = l->data;
+      Window xwindow = get_window_keygrab_xwindow (w);
 
-          ++i;
-        }
+      if (xwindow != None)
+        diff_keygrabs (keys, xwindow,
+                       old_snapshot->window_combos,
+                       old_snapshot->ignored_modifier_mask,
+                       new_snapshot.window_combos);
     }
+  g_slist_free (windows);
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "Updating key grabs took %u requests (%u in total)\n",
+              keys->n_keygrab_requests - n_requests,
+              keys->n_keygrab_requests);
+
+  g_array_free (old_snapshot->global_combos, TRUE);
+  g_array_free (old_snapshot->window_combos, TRUE);
+  g_array_free (new_snapshot.global_combos, TRUE);
+  g_array_free (new_snapshot.window_combos, TRUE);
+}
+
+static void
+meta_screen_change_keygrabs (MetaScreen *screen,
+                             gboolean    grab)
+{
+  MetaDisplay *display = screen->display;
+  MetaKeyBindingManager *keys = &display->key_binding_manager;
+  GArray *combos;
 
-  change_binding_keygrabs (keys, screen->xroot, FALSE, grab);
+  combos = get_grab_combos (keys, FALSE);
+  change_keygrabs (keys, screen->xroot, grab, combos);
+  g_array_free (combos, TRUE);
 }
 
 void
@@ -1304,7 +1544,11 @@ change_window_keygrabs (MetaKeyBindingManager *keys,
                         Window                 xwindow,
                         gboolean               grab)
 {
-  change_binding_keygrabs (keys, xwindow, TRUE, grab);
+  GArray *combos;
+
+  combos = get_grab_combos (keys, TRUE);
+  change_keygrabs (keys, xwindow, grab, combos);
+  g_array_free (combos, TRUE);
 }
 
 void
@@ -4083,6 +4327,7 @@ meta_display_init_keys (MetaDisplay *display)
   rebuild_key_binding_table (keys);
   rebuild_special_bindings (keys);
 
+  reload_keymap (keys);
   reload_combos (keys);
 
   update_window_grab_modifiers (keys);
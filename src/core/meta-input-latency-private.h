@@ -0,0 +1,44 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_INPUT_LATENCY_PRIVATE_H
+#define META_INPUT_LATENCY_PRIVATE_H
+
+#include <clutter/clutter.h>
+
+typedef enum {
+  META_INPUT_LATENCY_STAGE_QUEUED,
+  META_INPUT_LATENCY_STAGE_DISPATCHED,
+  META_INPUT_LATENCY_STAGE_DELIVERED,
+  META_INPUT_LATENCY_N_STAGES
+} MetaInputLatencyStage;
+
+/* Per-event state, lives on the stack of the event handler */
+typedef struct {
+  gint64 arrival_time;
+  int event_class;
+  gboolean active;
+} MetaInputLatencyTrace;
+
+void meta_input_latency_init  (void);
+
+void meta_input_latency_begin (MetaInputLatencyTrace *trace,
+                               const ClutterEvent    *event);
+void meta_input_latency_mark  (MetaInputLatencyTrace *trace,
+                               MetaInputLatencyStage  stage);
+
+#endif /* META_INPUT_LATENCY_PRIVATE_H */
@@ -0,0 +1,270 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Opt-in input latency tracing. When MUTTER_DEBUG_INPUT_LATENCY is set,
+ * every event going through the display event filter is timed at a few
+ * points of its way through mutter, and the latencies are aggregated
+ * into per event type histograms exported on the session bus as
+ * org.gnome.Mutter.InputLatency.
+ */
+
+#include "config.h"
+
+#include "meta-input-latency-private.h"
+#include "meta-dbus-input-latency.h"
+
+#include <meta/main.h>
+#include <meta/meta-backend.h>
+#include <meta/util.h>
+
+#include <string.h>
+
+#ifdef HAVE_NATIVE_BACKEND
+#include "backends/native/meta-backend-native.h"
+#endif
+
+/* Bucket 0 counts latencies below 1 us, bucket N those in
+ * [2^(N-1), 2^N) us; the last one everything from ~0.5 s on. */
+#define N_BUCKETS 21
+
+/* Device timestamps further off than this are considered bogus */
+#define MAX_QUEUED_LATENCY_MS (60 * 1000)
+
+typedef enum {
+  EVENT_CLASS_MOTION,
+  EVENT_CLASS_BUTTON,
+  EVENT_CLASS_KEY,
+  EVENT_CLASS_SCROLL,
+  EVENT_CLASS_TOUCH,
+  EVENT_CLASS_OTHER,
+  N_EVENT_CLASSES
+} EventClass;
+
+static const char * const event_class_names[N_EVENT_CLASSES] = {
+  "motion",
+  "button",
+  "key",
+  "scroll",
+  "touch",
+  "other",
+};
+
+static const char * const stage_names[META_INPUT_LATENCY_N_STAGES] = {
+  "queued",
+  "dispatched",
+  "delivered",
+};
+
+typedef struct {
+  guint64 total;
+  guint64 buckets[N_BUCKETS];
+} Histogram;
+
+typedef struct {
+  gboolean enabled;
+  gboolean device_time_is_monotonic;
+  Histogram histograms[N_EVENT_CLASSES][META_INPUT_LATENCY_N_STAGES];
+
+  MetaDBusInputLatency *skeleton;
+  guint dbus_name_id;
+} MetaInputLatency;
+
+static MetaInputLatency latency;
+
+static EventClass
+get_event_class (const ClutterEvent *event)
+{
+  switch (event->type)
+    {
+    case CLUTTER_MOTION:
+      return EVENT_CLASS_MOTION;
+    case CLUTTER_BUTTON_PRESS:
+    case CLUTTER_BUTTON_RELEASE:
+      return EVENT_CLASS_BUTTON;
+    case CLUTTER_KEY_PRESS:
+    case CLUTTER_KEY_RELEASE:
+      return EVENT_CLASS_KEY;
+    case CLUTTER_SCROLL:
+      return EVENT_CLASS_SCROLL;
+    case CLUTTER_TOUCH_BEGIN:
+    case CLUTTER_TOUCH_UPDATE:
+    case CLUTTER_TOUCH_END:
+    case CLUTTER_TOUCH_CANCEL:
+      return EVENT_CLASS_TOUCH;
+    default:
+      return EVENT_CLASS_OTHER;
+    }
+}
+
+static void
+record_latency (int                   event_class,
+                MetaInputLatencyStage stage,
+                guint64               latency_us)
+{
+  Histogram *histogram = &latency.histograms[event_class][stage];
+  guint bucket;
+
+  if (latency_us == 0)
+    bucket = 0;
+  else
+    bucket = MIN (g_bit_storage (latency_us), N_BUCKETS - 1);
+
+  histogram->total += latency_us;
+  histogram->buckets[bucket]++;
+}
+
+void
+meta_input_latency_begin (MetaInputLatencyTrace *trace,
+                          const ClutterEvent    *event)
+{
+  guint32 event_time;
+
+  trace->active = latency.enabled;
+  if (!trace->active)
+    return;
+
+  trace->arrival_time = g_get_monotonic_time ();
+  trace->event_class = get_event_class (event);
+
+  /* Only libinput timestamps share our clock; X server time doesn't. */
+  event_time = clutter_event_get_time (event);
+  if (latency.device_time_is_monotonic && event_time != CLUTTER_CURRENT_TIME &&
+      !(event->any.flags & CLUTTER_EVENT_FLAG_SYNTHETIC))
+    {
+      guint32 queued_ms = (guint32) (trace->arrival_time / 1000) - event_time;
+
+      if (queued_ms < MAX_QUEUED_LATENCY_MS)
+        record_latency (trace->event_class,
+                        META_INPUT_LATENCY_STAGE_QUEUED,
+                        (guint64) queued_ms * 1000);
+    }
+}
+
+void
+meta_input_latency_mark (MetaInputLatencyTrace *trace,
+                         MetaInputLatencyStage  stage)
+{
+  if (!trace->active)
+    return;
+
+  g_return_if_fail (stage != META_INPUT_LATENCY_STAGE_QUEUED);
+
+  record_latency (trace->event_class, stage,
+                  g_get_monotonic_time () - trace->arrival_time);
+}
+
+static gboolean
+handle_get_histograms (MetaDBusInputLatency  *skeleton,
+                       GDBusMethodInvocation *invocation,
+                       gpointer               user_data)
+{
+  GVariantBuilder builder;
+  int i, j, k;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sstat)"));
+
+  for (i = 0; i < N_EVENT_CLASSES; i++)
+    for (j = 0; j < META_INPUT_LATENCY_N_STAGES; j++)
+      {
+        Histogram *histogram = &latency.histograms[i][j];
+        GVariantBuilder buckets;
+
+        g_variant_builder_init (&buckets, G_VARIANT_TYPE ("at"));
+        for (k = 0; k < N_BUCKETS; k++)
+          g_variant_builder_add (&buckets, "t", histogram->buckets[k]);
+
+        g_variant_builder_add (&builder, "(sstat)",
+                               event_class_names[i],
+                               stage_names[j],
+                               histogram->total,
+                               &buckets);
+      }
+
+  meta_dbus_input_latency_complete_get_histograms (skeleton, invocation,
+                                                   g_variant_builder_end (&builder));
+  return TRUE;
+}
+
+static gboolean
+handle_reset (MetaDBusInputLatency  *skeleton,
+              GDBusMethodInvocation *invocation,
+              gpointer               user_data)
+{
+  memset (latency.histograms, 0, sizeof (latency.histograms));
+
+  meta_dbus_input_latency_complete_reset (skeleton, invocation);
+  return TRUE;
+}
+
+static void
+on_bus_acquired (GDBusConnection *connection,
+                 const char      *name,
+                 gpointer         user_data)
+{
+  g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (latency.skeleton),
+                                    connection,
+                                    "/org/gnome/Mutter/InputLatency",
+                                    NULL);
+}
+
+static void
+on_name_acquired (GDBusConnection *connection,
+                  const char      *name,
+                  gpointer         user_data)
+{
+  meta_topic (META_DEBUG_DBUS, "Acquired name %s\n", name);
+}
+
+static void
+on_name_lost (GDBusConnection *connection,
+              const char      *name,
+              gpointer         user_data)
+{
+  meta_topic (META_DEBUG_DBUS, "Lost or failed to acquire name %s\n", name);
+}
+
+void
+meta_input_latency_init (void)
+{
+  if (latency.enabled || !g_getenv ("MUTTER_DEBUG_INPUT_LATENCY"))
+    return;
+
+  latency.enabled = TRUE;
+
+#ifdef HAVE_NATIVE_BACKEND
+  latency.device_time_is_monotonic = META_IS_BACKEND_NATIVE (meta_get_backend ());
+#endif
+
+  latency.skeleton = meta_dbus_input_latency_skeleton_new ();
+  g_signal_connect (latency.skeleton, "handle-get-histograms",
+                    G_CALLBACK (handle_get_histograms), NULL);
+  g_signal_connect (latency.skeleton, "handle-reset",
+                    G_CALLBACK (handle_reset), NULL);
+
+  latency.dbus_name_id = g_bus_own_name (G_BUS_TYPE_SESSION,
+                                         "org.gnome.Mutter.InputLatency",
+                                         G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
+                                         (meta_get_replace_current_wm () ?
+                                          G_BUS_NAME_OWNER_FLAGS_REPLACE : 0),
+                                         on_bus_acquired,
+                                         on_name_acquired,
+                                         on_name_lost,
+                                         NULL, NULL);
+
+  meta_verbose ("Input latency tracing enabled\n");
+}
@@ -0,0 +1,45 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Mutter preferences, internal API */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_PREFS_PRIVATE_H
+#define META_PREFS_PRIVATE_H
+
+#include <meta/prefs.h>
+
+/* Set of MetaPreference values, one bit per preference */
+typedef guint64 MetaPrefsChangeSet;
+
+#define META_PREFS_CHANGE_SET_HAS(set, pref) \
+  (((set) & (G_GUINT64_CONSTANT (1) << (pref))) != 0)
+
+/* Batch listeners are invoked once per main loop iteration with the set
+ * of all preferences that changed since the last notification, after
+ * the per-preference listeners ran. Consumers that do expensive work in
+ * response to several related preferences should use these, so that
+ * e.g. applying a whole settings profile only causes one recomputation.
+ */
+typedef void (* MetaPrefsBatchChangedFunc) (MetaPrefsChangeSet changes,
+                                            gpointer           user_data);
+
+void meta_prefs_add_batch_listener    (MetaPrefsBatchChangedFunc func,
+                                       gpointer                  user_data);
+void meta_prefs_remove_batch_listener (MetaPrefsBatchChangedFunc func,
+                                       gpointer                  user_data);
+
+#endif
@@ -28,6 +28,7 @@
 
 #include <config.h>
 #include <meta/prefs.h>
+#include "prefs-private.h"
 #include "util-private.h"
 #include "meta-plugin-manager.h"
 #include <glib.h>
@@ -68,9 +69,11 @@
 
 #define SETTINGS(s) g_hash_table_lookup (settings_schemas, (s))
 
-static GList *changes = NULL;
+static MetaPrefsChangeSet changes = 0;
 static guint changed_idle;
+static gboolean emitting_changes = FALSE;
 static GList *listeners = NULL;
+static GList *batch_listeners = NULL;
 static GHashTable *settings_schemas;
 
 static gboolean use_system_font = FALSE;
@@ -159,6 +162,14 @@ typedef struct
   gpointer data;
 } MetaPrefsListener;
 
+typedef struct
+{
+  MetaPrefsBatchChangedFunc func;
+  gpointer data;
+} MetaPrefsBatchListener;
+
+G_STATIC_ASSERT (META_PREF_DRAG_THRESHOLD < 64);
+
 typedef struct
 {
   char *key;
@@ -856,11 +867,74 @@ meta_prefs_remove_listener (MetaPrefsChangedFunc func,
   meta_bug ("Did not find listener to remove\n");
 }
 
-static void
+/**
+ * meta_prefs_add_batch_listener: (skip)
+ * @func: a #MetaPrefsBatchChangedFunc
+ * @user_data: data passed to the function
+ *
+ */
+void
+meta_prefs_add_batch_listener (MetaPrefsBatchChangedFunc func,
+                               gpointer                  user_data)
+{
+  MetaPrefsBatchListener *l;
+
+  l = g_new (MetaPrefsBatchListener, 1);
+  l->func = func;
+  l->data = user_data;
+
+  batch_listeners = g_list_prepend (batch_listeners, l);
+}
+
+/**
+ * meta_prefs_remove_batch_listener: (skip)
+ * @func: a #MetaPrefsBatchChangedFunc
+ * @user_data: data passed to the function
+ *
+ */
+void
+meta_prefs_remove_batch_listener (MetaPrefsBatchChangedFunc func,
+                                  gpointer                  user_data)
+{
+  GList *tmp;
+
+  tmp = batch_listeners;
+  while (tmp != NULL)
+    {
+      MetaPrefsBatchListener *l = tmp->data;
+
+      if (l->func == func &&
+          l->data == user_data)
+        {
+          g_free (l);
+          batch_listeners = g_list_delete_link (batch_listeners, tmp);
+
+          return;
+        }
+
+      tmp = tmp->next;
+    }
+
+  meta_bug ("Did not find batch listener to remove\n");
+}
+
+static int
 emit_changed (MetaPreference pref)
 {
   GList *tmp;
   GList *copy;
+  int n_invocations = 0;
+
+  /* Batch listeners only hear about changes that go through the idle
+   * handler, so a direct emit would be missed by them.
+   */
+  if (!emitting_changes)
+    {
+      meta_warning ("Pref %s emitted outside of a change batch, queueing it\n",
+                    meta_preference_to_string (pref));
+      queue_changed (pref);
+      return 0;
+    }
 
   meta_topic (META_DEBUG_PREFS, "Notifying listeners that pref %s changed\n",
               meta_preference_to_string (pref));
@@ -874,38 +948,76 @@ emit_changed (MetaPreference pref)
       MetaPrefsListener *l = tmp->data;
 
       (* l->func) (pref, l->data);
+      n_invocations++;
 
       tmp = tmp->next;
     }
 
   g_list_free (copy);
+
+  return n_invocations;
 }
 
-static gboolean
-changed_idle_handler (gpointer data)
+static int
+emit_batch_changed (MetaPrefsChangeSet batch)
 {
   GList *tmp;
   GList *copy;
+  int n_invocations = 0;
 
-  changed_idle = 0;
-
-  copy = g_list_copy (changes); /* reentrancy paranoia */
-
-  g_list_free (changes);
-  changes = NULL;
+  copy = g_list_copy (batch_listeners);
 
   tmp = copy;
+
   while (tmp != NULL)
     {
-      MetaPreference pref = GPOINTER_TO_INT (tmp->data);
+      MetaPrefsBatchListener *l = tmp->data;
 
-      emit_changed (pref);
+      (* l->func) (batch, l->data);
+      n_invocations++;
 
       tmp = tmp->next;
     }
 
   g_list_free (copy);
 
+  return n_invocations;
+}
+
+static gboolean
+changed_idle_handler (gpointer data)
+{
+  MetaPrefsChangeSet batch;
+  int i;
+  int n_prefs = 0;
+  int n_invocations = 0;
+
+  changed_idle = 0;
+
+  /* reentrancy paranoia: listeners may queue further changes, those
+   * end up in the next batch */
+  batch = changes;
+  changes = 0;
+
+  emitting_changes = TRUE;
+
+  for (i = 0; i <= META_PREF_DRAG_THRESHOLD; i++)
+    {
+      if (!META_PREFS_CHANGE_SET_HAS (batch, i))
+        continue;
+
+      n_invocations += emit_changed ((MetaPreference) i);
+      n_prefs++;
+    }
+
+  n_invocations += emit_batch_changed (batch);
+
+  emitting_changes = FALSE;
+
+  meta_topic (META_DEBUG_PREFS,
+              "Change batch of %d prefs caused %d listener invocations\n",
+              n_prefs, n_invocations);
+
   return FALSE;
 }
 
@@ -915,8 +1027,8 @@ queue_changed (MetaPreference pref)
   meta_topic (META_DEBUG_PREFS, "Queueing change of pref %s\n",
               meta_preference_to_string (pref));
 
-  if (g_list_find (changes, GINT_TO_POINTER (pref)) == NULL)
-    changes = g_list_prepend (changes, GINT_TO_POINTER (pref));
+  if (!META_PREFS_CHANGE_SET_HAS (changes, pref))
+    changes |= G_GUINT64_CONSTANT (1) << pref;
   else
     meta_topic (META_DEBUG_PREFS, "Change of pref %s was already pending\n",
                 meta_preference_to_string (pref));
@@ -1655,7 +1767,7 @@ button_layout_handler (GVariant *value,
   if (!button_layout_equal (&button_layout, &new_layout))
     {
       button_layout = new_layout;
-      emit_changed (META_PREF_BUTTON_LAYOUT);
+      queue_changed (META_PREF_BUTTON_LAYOUT);
     }
 
   return TRUE;
@@ -68,6 +68,11 @@ struct _MetaScreen
 
   GList *workspaces;
 
+  /* While workspaces are frozen, windows whose workspace changed are
+   * collected here and only updated on the last thaw */
+  int workspace_freeze_count;
+  GHashTable *workspace_changed_windows;
+
   MetaStack *stack;
   MetaStackTracker *stack_tracker;
 
@@ -210,6 +215,9 @@ void     meta_screen_workspace_switched (MetaScreen         *screen,
 
 void meta_screen_set_active_workspace_hint (MetaScreen *screen);
 
+void meta_screen_freeze_workspaces (MetaScreen *screen);
+void meta_screen_thaw_workspaces   (MetaScreen *screen);
+
 void meta_screen_create_guard_window (MetaScreen *screen);
 
 gboolean meta_screen_handle_xevent (MetaScreen *screen,
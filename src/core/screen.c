@@ -36,6 +36,7 @@
 #include "window-private.h"
 #include "frame.h"
 #include <meta/prefs.h>
+#include "prefs-private.h"
 #include "workspace-private.h"
 #include "keybindings-private.h"
 #include "stack.h"
@@ -64,8 +65,8 @@ static char* get_screen_name (MetaDisplay *display,
 static void update_num_workspaces  (MetaScreen *screen,
                                     guint32     timestamp);
 static void set_workspace_names    (MetaScreen *screen);
-static void prefs_changed_callback (MetaPreference pref,
-                                    gpointer       data);
+static void prefs_changed_callback (MetaPrefsChangeSet changes,
+                                    gpointer           data);
 
 static void set_desktop_geometry_hint (MetaScreen *screen);
 static void set_desktop_viewport_hint (MetaScreen *screen);
@@ -672,6 +673,8 @@ meta_screen_new (MetaDisplay *display,
 
   screen->active_workspace = NULL;
   screen->workspaces = NULL;
+  screen->workspace_freeze_count = 0;
+  screen->workspace_changed_windows = g_hash_table_new (NULL, NULL);
   screen->rows_of_workspaces = 1;
   screen->columns_of_workspaces = -1;
   screen->vertical_workspaces = FALSE;
@@ -727,7 +730,7 @@ meta_screen_new (MetaDisplay *display,
   screen->stack = meta_stack_new (screen);
   screen->stack_tracker = meta_stack_tracker_new (screen);
 
-  meta_prefs_add_listener (prefs_changed_callback, screen);
+  meta_prefs_add_batch_listener (prefs_changed_callback, screen);
 
 #ifdef HAVE_STARTUP_NOTIFICATION
   screen->sn_context =
@@ -795,7 +798,7 @@ meta_screen_free (MetaScreen *screen,
 
   meta_display_unmanage_windows_for_screen (display, screen, timestamp);
 
-  meta_prefs_remove_listener (prefs_changed_callback, screen);
+  meta_prefs_remove_batch_listener (prefs_changed_callback, screen);
 
   meta_screen_ungrab_keys (screen);
 
@@ -845,6 +848,8 @@ meta_screen_free (MetaScreen *screen,
 
   g_free (screen->screen_name);
 
+  g_hash_table_destroy (screen->workspace_changed_windows);
+
   g_object_unref (screen);
 }
 
@@ -880,13 +885,13 @@ meta_screen_manage_all_windows (MetaScreen *screen)
 }
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        gpointer       data)
+prefs_changed_callback (MetaPrefsChangeSet changes,
+                        gpointer           data)
 {
   MetaScreen *screen = data;
 
-  if ((pref == META_PREF_NUM_WORKSPACES ||
-       pref == META_PREF_DYNAMIC_WORKSPACES) &&
+  if ((META_PREFS_CHANGE_SET_HAS (changes, META_PREF_NUM_WORKSPACES) ||
+       META_PREFS_CHANGE_SET_HAS (changes, META_PREF_DYNAMIC_WORKSPACES)) &&
       !meta_prefs_get_dynamic_workspaces ())
     {
       /* GSettings doesn't provide timestamps, but luckily update_num_workspaces
@@ -896,7 +901,8 @@ prefs_changed_callback (MetaPreference pref,
         meta_display_get_current_time_roundtrip (screen->display);
       update_num_workspaces (screen, timestamp);
     }
-  else if (pref == META_PREF_WORKSPACE_NAMES)
+
+  if (META_PREFS_CHANGE_SET_HAS (changes, META_PREF_WORKSPACE_NAMES))
     {
       set_workspace_names (screen);
     }
@@ -941,10 +947,7 @@ meta_screen_foreach_window (MetaScreen           *screen,
 {
   GSList *windows;
 
-  /* If we end up doing this often, just keeping a list
-   * of windows might be sensible.
-   */
-
+  /* Iterate over a snapshot, since func may manage or unmanage windows */
   windows = meta_display_list_windows (screen->display, flags);
 
   g_slist_foreach (windows, (GFunc) func, data);
@@ -1053,6 +1056,8 @@ meta_screen_remove_workspace (MetaScreen *screen, MetaWorkspace *workspace,
   int            index;
   gboolean       active_index_changed;
   int            new_num;
+  guint          n_windows;
+  gint64         start_time;
 
   l = g_list_find (screen->workspaces, workspace);
   if (!l)
@@ -1070,6 +1075,13 @@ meta_screen_remove_workspace (MetaScreen *screen, MetaWorkspace *workspace,
       return;
     }
 
+  start_time = g_get_monotonic_time ();
+
+  /* Windows moved to the neighbour may also have their workspace index
+   * change below; only update them once.
+   */
+  meta_screen_freeze_workspaces (screen);
+
   meta_workspace_relocate_windows (workspace, neighbour);
 
   if (workspace == screen->active_workspace)
@@ -1100,6 +1112,13 @@ meta_screen_remove_workspace (MetaScreen *screen, MetaWorkspace *workspace,
       meta_workspace_index_changed (w);
     }
 
+  n_windows = g_hash_table_size (screen->workspace_changed_windows);
+  meta_screen_thaw_workspaces (screen);
+
+  meta_topic (META_DEBUG_WINDOW_OPS,
+              "Removed workspace %d, updating %u windows, in %" G_GINT64_FORMAT " us\n",
+              index, n_windows, g_get_monotonic_time () - start_time);
+
   meta_screen_queue_workarea_recalc (screen);
 
   g_signal_emit (screen, screen_signals[WORKSPACE_REMOVED], 0, index);
@@ -1193,6 +1212,8 @@ update_num_workspaces (MetaScreen *screen,
   if (g_list_length (screen->workspaces) == (guint) new_num)
     return;
 
+  meta_screen_freeze_workspaces (screen);
+
   last_remaining = NULL;
   extras = NULL;
   i = 0;
@@ -1245,6 +1266,8 @@ update_num_workspaces (MetaScreen *screen,
   for (i = old_num; i < new_num; i++)
     meta_workspace_new (screen);
 
+  meta_screen_thaw_workspaces (screen);
+
   set_number_of_spaces_hint (screen, new_num);
 
   meta_screen_queue_workarea_recalc (screen);
@@ -1255,6 +1278,47 @@ update_num_workspaces (MetaScreen *screen,
   g_object_notify (G_OBJECT (screen), "n-workspaces");
 }
 
+/**
+ * meta_screen_freeze_workspaces:
+ * @screen: a #MetaScreen
+ *
+ * Starts a batch of workspace changes. Until the matching
+ * meta_screen_thaw_workspaces(), windows that change workspace, or whose
+ * workspace changes index, are only recorded; they are updated once, in a
+ * single burst of requests, when the batch ends.
+ */
+void
+meta_screen_freeze_workspaces (MetaScreen *screen)
+{
+  screen->workspace_freeze_count++;
+}
+
+void
+meta_screen_thaw_workspaces (MetaScreen *screen)
+{
+  GHashTableIter iter;
+  gpointer key;
+
+  g_return_if_fail (screen->workspace_freeze_count > 0);
+
+  screen->workspace_freeze_count--;
+  if (screen->workspace_freeze_count > 0)
+    return;
+
+  if (g_hash_table_size (screen->workspace_changed_windows) == 0)
+    return;
+
+  meta_topic (META_DEBUG_WINDOW_OPS,
+              "Updating the workspace of %u windows\n",
+              g_hash_table_size (screen->workspace_changed_windows));
+
+  g_hash_table_iter_init (&iter, screen->workspace_changed_windows);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    meta_window_current_workspace_changed (key);
+
+  g_hash_table_remove_all (screen->workspace_changed_windows);
+}
+
 void
 meta_screen_update_cursor (MetaScreen *screen)
 {
@@ -2465,7 +2529,7 @@ meta_screen_show_desktop (MetaScreen *screen,
   /* Focus the most recently used META_WINDOW_DESKTOP window, if there is one;
    * see bug 159257.
    */
-  for (l = screen->active_workspace->mru_list; l != NULL; l = l->next)
+  for (l = screen->active_workspace->mru_list.head; l != NULL; l = l->next)
     {
       MetaWindow *w = l->data;
 
@@ -1229,6 +1229,18 @@ window_contains_point (MetaWindow *window,
   return POINT_IN_RECT (root_x, root_y, rect);
 }
 
+/* Whether window could ever take the focus from get_default_focus_window();
+ * these are cheap checks of fixed properties, done before anything that
+ * depends on the window's state or geometry.
+ */
+static gboolean
+is_focus_candidate (MetaWindow *window)
+{
+  return (window->input || window->take_focus) &&
+         window->type != META_WINDOW_DOCK &&
+         !window->unmanaging;
+}
+
 static MetaWindow*
 get_default_focus_window (MetaStack     *stack,
                           MetaWorkspace *workspace,
@@ -1241,8 +1253,13 @@ get_default_focus_window (MetaStack     *stack,
    * not_this_one is being unfocused or going away, so exclude it.
    */
 
+  MetaWindow *result = NULL;
+  gint64 start_time;
+  int n_examined = 0;
   GList *l;
 
+  start_time = g_get_monotonic_time ();
+
   stack_ensure_sorted (stack);
 
   /* top of this layer is at the front of the list */
@@ -1253,31 +1270,34 @@ get_default_focus_window (MetaStack     *stack,
       if (!window)
         continue;
 
-      if (window == not_this_one)
-        continue;
-
-      if (window->unmaps_pending > 0)
-        continue;
+      n_examined++;
 
-      if (window->unmanaging)
+      if (window == not_this_one)
         continue;
 
-      if (!(window->input || window->take_focus))
+      if (!is_focus_candidate (window))
         continue;
 
-      if (!meta_window_should_be_showing (window))
+      if (window->unmaps_pending > 0)
         continue;
 
       if (must_be_at_point && !window_contains_point (window, root_x, root_y))
         continue;
 
-      if (window->type == META_WINDOW_DOCK)
+      if (!meta_window_should_be_showing (window))
         continue;
 
-      return window;
+      result = window;
+      break;
     }
 
-  return NULL;
+  meta_topic (META_DEBUG_FOCUS,
+              "Default focus window is %s, found after examining %d windows "
+              "in %" G_GINT64_FORMAT " us\n",
+              result ? result->desc : "none", n_examined,
+              g_get_monotonic_time () - start_time);
+
+  return result;
 }
 
 MetaWindow*
@@ -1328,6 +1348,12 @@ meta_stack_list_windows (MetaStack     *stack,
   return workspace_windows;
 }
 
+void
+meta_stack_ensure_sorted (MetaStack *stack)
+{
+  stack_ensure_sorted (stack);
+}
+
 int
 meta_stack_windows_cmp  (MetaStack  *stack,
                          MetaWindow *window_a,
@@ -351,6 +351,16 @@ MetaWindow* meta_stack_get_default_focus_window_at_point (MetaStack     *stack,
 GList*      meta_stack_list_windows (MetaStack *stack,
                                      MetaWorkspace *workspace);
 
+/**
+ * meta_stack_ensure_sorted:
+ * @stack: The stack to update.
+ *
+ * Brings the stack up to date with pending additions, removals and
+ * restacks, so that stack->sorted and the stack_position of each
+ * window can be read directly.
+ */
+void        meta_stack_ensure_sorted (MetaStack *stack);
+
 /**
  * meta_stack_windows_cmp:
  * @stack: A stack containing both window_a and window_b
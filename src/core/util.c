@@ -727,6 +727,8 @@ meta_show_dialog (const char *type,
 
 static guint last_later_id = 0;
 
+#define N_LATER_TYPES (META_LATER_IDLE + 1)
+
 typedef struct
 {
   guint id;
@@ -737,9 +739,28 @@ typedef struct
   GDestroyNotify notify;
   int source;
   gboolean run_once;
+
+  /* Link in the queue of laters of the same type */
+  GList link;
 } MetaLater;
 
-static GSList *laters = NULL;
+/* One queue per MetaLaterType, in the order the laters were added, and
+ * an index by id for meta_later_remove() */
+static GQueue laters[N_LATER_TYPES];
+static GHashTable *laters_by_id;
+
+/* Laters to be run by the current run_repaint_laters() */
+static GPtrArray *laters_to_run;
+
+static const char * const later_type_names[N_LATER_TYPES] = {
+  "resize",
+  "calc-showing",
+  "check-fullscreen",
+  "sync-stack",
+  "before-redraw",
+  "idle",
+};
+
 /* This is a dummy timeline used to get the Clutter master clock running */
 static ClutterTimeline *later_timeline;
 static guint later_repaint_func = 0;
@@ -772,56 +793,77 @@ destroy_later (MetaLater *later)
   unref_later (later);
 }
 
-/* Used to sort the list of laters with the highest priority
- * functions first.
- */
-static int
-compare_laters (gconstpointer a,
-                gconstpointer b)
-{
-  return ((const MetaLater *)a)->when - ((const MetaLater *)b)->when;
-}
-
 static gboolean
 run_repaint_laters (gpointer data)
 {
-  GSList *laters_copy;
-  GSList *l;
   gboolean keep_timeline_running = FALSE;
+  guint type_start[N_LATER_TYPES + 1];
+  guint i, type;
 
-  laters_copy = NULL;
-  for (l = laters; l; l = l->next)
+  if (!laters_to_run)
+    laters_to_run = g_ptr_array_new ();
+
+  /* Collect everything up front, so that laters added while running
+   * these wait for the next repaint */
+  for (type = 0; type < N_LATER_TYPES; type++)
     {
-      MetaLater *later = l->data;
-      if (later->source == 0 ||
-          (later->when <= META_LATER_BEFORE_REDRAW && !later->run_once))
+      GList *l;
+
+      type_start[type] = laters_to_run->len;
+
+      /* Idle laters are only ever run from their idle source */
+      if (type > META_LATER_BEFORE_REDRAW)
+        continue;
+
+      for (l = laters[type].head; l; l = l->next)
         {
-          later->ref_count++;
-          laters_copy = g_slist_prepend (laters_copy, later);
+          MetaLater *later = l->data;
+
+          if (later->source == 0 || !later->run_once)
+            {
+              later->ref_count++;
+              g_ptr_array_add (laters_to_run, later);
+            }
         }
     }
-  laters_copy = g_slist_reverse (laters_copy);
+  type_start[N_LATER_TYPES] = laters_to_run->len;
 
-  for (l = laters_copy; l; l = l->next)
+  for (type = 0; type < N_LATER_TYPES; type++)
     {
-      MetaLater *later = l->data;
+      gint64 start_time;
+
+      if (type_start[type] == type_start[type + 1])
+        continue;
 
-      if (later->func && later->func (later->data))
+      start_time = g_get_monotonic_time ();
+
+      for (i = type_start[type]; i < type_start[type + 1]; i++)
         {
-          if (later->source == 0)
-            keep_timeline_running = TRUE;
+          MetaLater *later = g_ptr_array_index (laters_to_run, i);
+
+          if (later->func && later->func (later->data))
+            {
+              if (later->source == 0)
+                keep_timeline_running = TRUE;
+            }
+          else
+            meta_later_remove (later->id);
+          unref_later (later);
         }
-      else
-        meta_later_remove (later->id);
-      unref_later (later);
+
+      meta_topic (META_DEBUG_COMPOSITOR,
+                  "Ran %u %s laters in %" G_GINT64_FORMAT " us\n",
+                  type_start[type + 1] - type_start[type],
+                  later_type_names[type],
+                  g_get_monotonic_time () - start_time);
     }
 
   if (!keep_timeline_running)
     clutter_timeline_stop (later_timeline);
 
-  g_slist_free (laters_copy);
+  g_ptr_array_set_size (laters_to_run, 0);
 
-  /* Just keep the repaint func around - it's cheap if the list is empty */
+  /* Just keep the repaint func around - it's cheap if there are no laters */
   return TRUE;
 }
 
@@ -879,16 +921,25 @@ meta_later_add (MetaLaterType  when,
                 gpointer       data,
                 GDestroyNotify notify)
 {
-  MetaLater *later = g_slice_new0 (MetaLater);
+  MetaLater *later;
+
+  g_return_val_if_fail (when < N_LATER_TYPES, 0);
 
+  later = g_slice_new0 (MetaLater);
   later->id = ++last_later_id;
   later->ref_count = 1;
   later->when = when;
   later->func = func;
   later->data = data;
   later->notify = notify;
+  later->link.data = later;
 
-  laters = g_slist_insert_sorted (laters, later, compare_laters);
+  if (!laters_by_id)
+    laters_by_id = g_hash_table_new (NULL, NULL);
+
+  /* Within a type, the newest later runs first, as it always has */
+  g_queue_push_head_link (&laters[when], &later->link);
+  g_hash_table_insert (laters_by_id, GUINT_TO_POINTER (later->id), later);
 
   switch (when)
     {
@@ -929,21 +980,22 @@ meta_later_add (MetaLaterType  when,
 void
 meta_later_remove (guint later_id)
 {
-  GSList *l;
+  MetaLater *later;
 
-  for (l = laters; l; l = l->next)
-    {
-      MetaLater *later = l->data;
-      if (later->id == later_id)
-        {
-          laters = g_slist_delete_link (laters, l);
-          /* If this was a "repaint func" later, we just let the
-           * repaint func run and get removed
-           */
-          destroy_later (later);
-          return;
-        }
-    }
+  if (!laters_by_id)
+    return;
+
+  later = g_hash_table_lookup (laters_by_id, GUINT_TO_POINTER (later_id));
+  if (!later)
+    return;
+
+  g_hash_table_remove (laters_by_id, GUINT_TO_POINTER (later_id));
+  g_queue_unlink (&laters[later->when], &later->link);
+
+  /* If this was a "repaint func" later, we just let the
+   * repaint func run and get removed
+   */
+  destroy_later (later);
 }
 
 MetaLocaleDirection
@@ -433,6 +433,13 @@ struct _MetaWindow
   MetaStackLayer layer;
   int stack_position; /* see comment in stack.h */
 
+  /* Links in the pending queues, managed by meta_window_queue() */
+  GList queue_link[NUMBER_OF_QUEUES];
+
+  /* Managed by meta_display_track_window() */
+  guint registry_index;
+  GList global_mru_link;
+
   /* Managed by delete.c */
   int dialog_pid;
 
@@ -1058,6 +1058,8 @@ _meta_window_shared_new (MetaDisplay         *display,
         meta_display_get_current_time_roundtrip (window->display);
   }
 
+  meta_display_track_window (window->display, window);
+
   window->attached = meta_window_should_attach_to_parent (window);
   if (window->attached)
     meta_window_recalc_features (window);
@@ -1269,6 +1271,9 @@ meta_window_unmanage (MetaWindow  *window,
 
   window->unmanaging = TRUE;
 
+  meta_display_untrack_window (window->display, window);
+  g_hash_table_remove (window->screen->workspace_changed_windows, window);
+
 #ifdef HAVE_WAYLAND
   /* This needs to happen for both Wayland and XWayland clients,
    * so it can't be in MetaWindowWayland. */
@@ -1383,7 +1388,7 @@ meta_window_unmanage (MetaWindow  *window,
       MetaWorkspace *workspace = tmp->data;
 
       g_assert (g_list_find (workspace->windows, window) == NULL);
-      g_assert (g_list_find (workspace->mru_list, window) == NULL);
+      g_assert (!g_hash_table_contains (workspace->mru_links, window));
 
       tmp = tmp->next;
     }
@@ -1588,33 +1593,95 @@ meta_window_calc_showing (MetaWindow  *window)
 }
 
 static guint queue_later[NUMBER_OF_QUEUES] = {0, 0, 0};
-static GSList *queue_pending[NUMBER_OF_QUEUES] = {NULL, NULL, NULL};
+static GQueue queue_pending[NUMBER_OF_QUEUES] = {
+  G_QUEUE_INIT, G_QUEUE_INIT, G_QUEUE_INIT
+};
 
-static int
-stackcmp (gconstpointer a, gconstpointer b)
+static gboolean
+window_is_queue_pending (MetaWindow *window,
+                         guint       queuenum)
 {
-  MetaWindow *aw = (gpointer) a;
-  MetaWindow *bw = (gpointer) b;
+  GList *link = &window->queue_link[queuenum];
 
-  if (aw->screen != bw->screen)
-    return 0; /* don't care how they sort with respect to each other */
-  else
-    return meta_stack_windows_cmp (aw->screen->stack,
-                                   aw, bw);
+  return link->prev != NULL || queue_pending[queuenum].head == link;
+}
+
+/* Empties the pending queue, returning the windows that were in it.
+ * Working with the returned array is what makes it OK to queue and
+ * unqueue windows while it is being processed.
+ */
+static GPtrArray *
+take_queue_pending (guint queuenum)
+{
+  GPtrArray *windows;
+  GList *link;
+
+  windows = g_ptr_array_sized_new (queue_pending[queuenum].length);
+  while ((link = g_queue_pop_head_link (&queue_pending[queuenum])))
+    g_ptr_array_add (windows, link->data);
+
+  queue_later[queuenum] = 0;
+
+  return windows;
+}
+
+/* Returns the windows in @windows from bottom to top of the stack. Rather
+ * than sorting, this walks the stack once and picks out the windows that
+ * are waiting in the calc_showing queue.
+ */
+static GPtrArray *
+sort_calc_showing_windows (GPtrArray *windows)
+{
+  MetaWindow *first;
+  GPtrArray *sorted;
+  GList *l;
+  guint i;
+
+  if (windows->len < 2)
+    return g_ptr_array_ref (windows);
+
+  first = g_ptr_array_index (windows, 0);
+  meta_stack_ensure_sorted (first->screen->stack);
+
+  /* stack->sorted has the topmost window first */
+  sorted = g_ptr_array_sized_new (windows->len);
+  for (l = g_list_last (first->screen->stack->sorted); l; l = l->prev)
+    {
+      MetaWindow *window = l->data;
+
+      if (window && (window->is_in_queues & META_QUEUE_CALC_SHOWING))
+        g_ptr_array_add (sorted, window);
+    }
+
+  /* Override redirect windows are not in the stack; they are above
+   * everything else and in no particular order amongst themselves.
+   */
+  for (i = 0; i < windows->len; i++)
+    {
+      MetaWindow *window = g_ptr_array_index (windows, i);
+
+      if (window->override_redirect)
+        g_ptr_array_add (sorted, window);
+    }
+
+  g_warn_if_fail (sorted->len == windows->len);
+
+  return sorted;
 }
 
 static gboolean
 idle_calc_showing (gpointer data)
 {
+  GPtrArray *windows;
+  GPtrArray *sorted;
   GSList *tmp;
-  GSList *copy;
   GSList *should_show;
   GSList *should_hide;
   GSList *unplaced;
-  GSList *displays;
   guint queue_index = GPOINTER_TO_INT (data);
+  guint i;
 
-  g_return_val_if_fail (queue_pending[queue_index] != NULL, FALSE);
+  g_return_val_if_fail (queue_pending[queue_index].head != NULL, FALSE);
 
   meta_topic (META_DEBUG_WINDOW_STATE,
               "Clearing the calc_showing queue\n");
@@ -1623,10 +1690,7 @@ idle_calc_showing (gpointer data)
    * complete; destroying a window while we're in here would result in
    * badness. But it's OK to queue/unqueue calc_showings.
    */
-  copy = g_slist_copy (queue_pending[queue_index]);
-  g_slist_free (queue_pending[queue_index]);
-  queue_pending[queue_index] = NULL;
-  queue_later[queue_index] = 0;
+  windows = take_queue_pending (queue_index);
 
   destroying_windows_disallowed += 1;
 
@@ -1638,14 +1702,11 @@ idle_calc_showing (gpointer data)
   should_show = NULL;
   should_hide = NULL;
   unplaced = NULL;
-  displays = NULL;
 
-  tmp = copy;
-  while (tmp != NULL)
+  sorted = sort_calc_showing_windows (windows);
+  for (i = 0; i < sorted->len; i++)
     {
-      MetaWindow *window;
-
-      window = tmp->data;
+      MetaWindow *window = g_ptr_array_index (sorted, i);
 
       if (!window->placed)
         unplaced = g_slist_prepend (unplaced, window);
@@ -1653,16 +1714,13 @@ idle_calc_showing (gpointer data)
         should_show = g_slist_prepend (should_show, window);
       else
         should_hide = g_slist_prepend (should_hide, window);
-
-      tmp = tmp->next;
     }
+  g_ptr_array_unref (sorted);
 
   /* bottom to top */
-  unplaced = g_slist_sort (unplaced, stackcmp);
-  should_hide = g_slist_sort (should_hide, stackcmp);
-  /* top to bottom */
-  should_show = g_slist_sort (should_show, stackcmp);
-  should_show = g_slist_reverse (should_show);
+  unplaced = g_slist_reverse (unplaced);
+  should_hide = g_slist_reverse (should_hide);
+  /* should_show is already top to bottom */
 
   tmp = unplaced;
   while (tmp != NULL)
@@ -1700,21 +1758,16 @@ idle_calc_showing (gpointer data)
       tmp = tmp->next;
     }
 
-  tmp = copy;
-  while (tmp != NULL)
+  for (i = 0; i < windows->len; i++)
     {
-      MetaWindow *window;
-
-      window = tmp->data;
+      MetaWindow *window = g_ptr_array_index (windows, i);
 
       /* important to set this here for reentrancy -
-       * if we queue a window again while it's in "copy",
+       * if we queue a window again while it's in "windows",
        * then queue_calc_showing will just return since
        * we are still in the calc_showing queue
        */
       window->is_in_queues &= ~META_QUEUE_CALC_SHOWING;
-
-      tmp = tmp->next;
     }
 
   if (meta_prefs_get_focus_mode () != G_DESKTOP_FOCUS_MODE_CLICK)
@@ -1736,12 +1789,11 @@ idle_calc_showing (gpointer data)
         }
     }
 
-  g_slist_free (copy);
+  g_ptr_array_unref (windows);
 
   g_slist_free (unplaced);
   g_slist_free (should_show);
   g_slist_free (should_hide);
-  g_slist_free (displays);
 
   destroying_windows_disallowed -= 1;
 
@@ -1771,16 +1823,19 @@ meta_window_unqueue (MetaWindow *window, guint queuebits)
               meta_window_queue_names[queuenum]);
 
           /* Note that window may not actually be in the queue
-           * because it may have been in "copy" inside the idle handler
+           * because it may have been taken by the idle handler
            */
-          queue_pending[queuenum] = g_slist_remove (queue_pending[queuenum], window);
+          if (window_is_queue_pending (window, queuenum))
+            g_queue_unlink (&queue_pending[queuenum],
+                            &window->queue_link[queuenum]);
           window->is_in_queues &= ~(1<<queuenum);
 
           /* Okay, so maybe we've used up all the entries in the queue.
            * In that case, we should kill the function that deals with
            * the queue, because there's nothing left for it to do.
            */
-          if (queue_pending[queuenum] == NULL && queue_later[queuenum] != 0)
+          if (g_queue_is_empty (&queue_pending[queuenum]) &&
+              queue_later[queuenum] != 0)
             {
               meta_later_remove (queue_later[queuenum]);
               queue_later[queuenum] = 0;
@@ -1866,8 +1921,9 @@ meta_window_queue (MetaWindow *window, guint queuebits)
               );
 
           /* And now we actually put it on the queue. */
-          queue_pending[queuenum] = g_slist_prepend (queue_pending[queuenum],
-                                                     window);
+          window->queue_link[queuenum].data = window;
+          g_queue_push_head_link (&queue_pending[queuenum],
+                                  &window->queue_link[queuenum]);
       }
   }
 }
@@ -3856,9 +3912,9 @@ meta_window_move_resize_now (MetaWindow  *window)
 static gboolean
 idle_move_resize (gpointer data)
 {
-  GSList *tmp;
-  GSList *copy;
+  GPtrArray *windows;
   guint queue_index = GPOINTER_TO_INT (data);
+  guint i;
 
   meta_topic (META_DEBUG_GEOMETRY, "Clearing the move_resize queue\n");
 
@@ -3866,27 +3922,19 @@ idle_move_resize (gpointer data)
    * complete; destroying a window while we're in here would result in
    * badness. But it's OK to queue/unqueue move_resizes.
    */
-  copy = g_slist_copy (queue_pending[queue_index]);
-  g_slist_free (queue_pending[queue_index]);
-  queue_pending[queue_index] = NULL;
-  queue_later[queue_index] = 0;
+  windows = take_queue_pending (queue_index);
 
   destroying_windows_disallowed += 1;
 
-  tmp = copy;
-  while (tmp != NULL)
+  for (i = 0; i < windows->len; i++)
     {
-      MetaWindow *window;
-
-      window = tmp->data;
+      MetaWindow *window = g_ptr_array_index (windows, i);
 
       /* As a side effect, sets window->move_resize_queued = FALSE */
       meta_window_move_resize_now (window);
-
-      tmp = tmp->next;
     }
 
-  g_slist_free (copy);
+  g_ptr_array_unref (windows);
 
   destroying_windows_disallowed -= 1;
 
@@ -4494,6 +4542,12 @@ meta_window_unstick (MetaWindow  *window)
 void
 meta_window_current_workspace_changed (MetaWindow *window)
 {
+  if (window->screen->workspace_freeze_count > 0 && !window->unmanaging)
+    {
+      g_hash_table_add (window->screen->workspace_changed_windows, window);
+      return;
+    }
+
   META_WINDOW_GET_CLASS (window)->current_workspace_changed (window);
 }
 
@@ -4734,21 +4788,8 @@ meta_window_set_focused_internal (MetaWindow *window,
       if (window->screen->active_workspace &&
           meta_window_located_on_workspace (window,
                                             window->screen->active_workspace))
-        {
-          GList* link;
-          link = g_list_find (window->screen->active_workspace->mru_list,
-                              window);
-          g_assert (link);
-
-          window->screen->active_workspace->mru_list =
-            g_list_remove_link (window->screen->active_workspace->mru_list,
-                                link);
-          g_list_free (link);
-
-          window->screen->active_workspace->mru_list =
-            g_list_prepend (window->screen->active_workspace->mru_list,
-                            window);
-        }
+        meta_workspace_mru_move_to_front (window->screen->active_workspace,
+                                          window);
 
       if (window->frame)
         meta_frame_queue_draw (window->frame);
@@ -4950,9 +4991,9 @@ meta_window_update_icon_now (MetaWindow *window,
 static gboolean
 idle_update_icon (gpointer data)
 {
-  GSList *tmp;
-  GSList *copy;
+  GPtrArray *windows;
   guint queue_index = GPOINTER_TO_INT (data);
+  guint i;
 
   meta_topic (META_DEBUG_GEOMETRY, "Clearing the update_icon queue\n");
 
@@ -4960,27 +5001,19 @@ idle_update_icon (gpointer data)
    * complete; destroying a window while we're in here would result in
    * badness. But it's OK to queue/unqueue update_icons.
    */
-  copy = g_slist_copy (queue_pending[queue_index]);
-  g_slist_free (queue_pending[queue_index]);
-  queue_pending[queue_index] = NULL;
-  queue_later[queue_index] = 0;
+  windows = take_queue_pending (queue_index);
 
   destroying_windows_disallowed += 1;
 
-  tmp = copy;
-  while (tmp != NULL)
+  for (i = 0; i < windows->len; i++)
     {
-      MetaWindow *window;
-
-      window = tmp->data;
+      MetaWindow *window = g_ptr_array_index (windows, i);
 
       meta_window_update_icon_now (window, FALSE);
       window->is_in_queues &= ~META_QUEUE_UPDATE_ICON;
-
-      tmp = tmp->next;
     }
 
-  g_slist_free (copy);
+  g_ptr_array_unref (windows);
 
   destroying_windows_disallowed -= 1;
 
@@ -6439,39 +6472,12 @@ static void
 ensure_mru_position_after (MetaWindow *window,
                            MetaWindow *after_this_one)
 {
-  /* This is sort of slow since it runs through the entire list more
-   * than once (especially considering the fact that we expect the
-   * windows of interest to be the first two elements in the list),
-   * but it doesn't matter while we're only using it on new window
-   * map.
+  /* after_this_one is not in the active workspace's MRU list when we
+   * switch workspaces, but in that case we don't need to do any MRU
+   * shuffling and meta_workspace_mru_place_after() simply returns.
    */
-
-  GList* active_mru_list;
-  GList* window_position;
-  GList* after_this_one_position;
-
-  active_mru_list         = window->screen->active_workspace->mru_list;
-  window_position         = g_list_find (active_mru_list, window);
-  after_this_one_position = g_list_find (active_mru_list, after_this_one);
-
-  /* after_this_one_position is NULL when we switch workspaces, but in
-   * that case we don't need to do any MRU shuffling so we can simply
-   * return.
-   */
-  if (after_this_one_position == NULL)
-    return;
-
-  if (g_list_length (window_position) > g_list_length (after_this_one_position))
-    {
-      window->screen->active_workspace->mru_list =
-        g_list_delete_link (window->screen->active_workspace->mru_list,
-                            window_position);
-
-      window->screen->active_workspace->mru_list =
-        g_list_insert_before (window->screen->active_workspace->mru_list,
-                              after_this_one_position->next,
-                              window);
-    }
+  meta_workspace_mru_place_after (window->screen->active_workspace,
+                                  window, after_this_one);
 }
 
 void
@@ -6546,6 +6552,8 @@ meta_window_set_user_time (MetaWindow *window,
                   window->desc, timestamp);
       window->net_wm_user_time_set = TRUE;
       window->net_wm_user_time = timestamp;
+      if (window->global_mru_link.data != NULL)
+        meta_display_update_window_mru (window->display, window);
       if (XSERVER_TIME_IS_BEFORE (window->display->last_user_time, timestamp))
         window->display->last_user_time = timestamp;
 
@@ -49,8 +49,12 @@ struct _MetaWorkspace
    * It used to be used to calculate the default focused window,
    * but isn't anymore, as the window next in the stacking order
    * can sometimes be not the window the user interacted with last,
+   *
+   * mru_links maps each window to its link in mru_list, so that
+   * windows can be moved around without searching the list.
    */
-  GList *mru_list;
+  GQueue mru_list;
+  GHashTable *mru_links;
 
   GList  *list_containing_self;
 
@@ -82,6 +86,14 @@ void           meta_workspace_remove_window (MetaWorkspace *workspace,
 void           meta_workspace_relocate_windows (MetaWorkspace *workspace,
                                                 MetaWorkspace *new_home);
 
+void meta_workspace_mru_move_to_front (MetaWorkspace *workspace,
+                                       MetaWindow    *window);
+void meta_workspace_mru_move_to_back  (MetaWorkspace *workspace,
+                                       MetaWindow    *window);
+void meta_workspace_mru_place_after   (MetaWorkspace *workspace,
+                                       MetaWindow    *window,
+                                       MetaWindow    *after_this_one);
+
 void meta_workspace_invalidate_work_area (MetaWorkspace *workspace);
 
 GList* meta_workspace_get_onscreen_region       (MetaWorkspace *workspace);
@@ -178,7 +178,8 @@ meta_workspace_new (MetaScreen *screen)
   workspace->screen->workspaces =
     g_list_append (workspace->screen->workspaces, workspace);
   workspace->windows = NULL;
-  workspace->mru_list = NULL;
+  g_queue_init (&workspace->mru_list);
+  workspace->mru_links = g_hash_table_new (NULL, NULL);
 
   workspace->work_areas_invalid = TRUE;
   workspace->work_area_monitor = NULL;
@@ -279,7 +280,8 @@ meta_workspace_remove (MetaWorkspace *workspace)
 
   g_free (workspace->work_area_monitor);
 
-  g_list_free (workspace->mru_list);
+  g_queue_clear (&workspace->mru_list);
+  g_hash_table_destroy (workspace->mru_links);
   g_list_free (workspace->list_containing_self);
 
   workspace_free_builtin_struts (workspace);
@@ -313,8 +315,9 @@ void
 meta_workspace_add_window (MetaWorkspace *workspace,
                            MetaWindow    *window)
 {
-  g_assert (g_list_find (workspace->mru_list, window) == NULL);
-  workspace->mru_list = g_list_prepend (workspace->mru_list, window);
+  g_assert (!g_hash_table_contains (workspace->mru_links, window));
+  g_queue_push_head (&workspace->mru_list, window);
+  g_hash_table_insert (workspace->mru_links, window, workspace->mru_list.head);
 
   workspace->windows = g_list_prepend (workspace->windows, window);
 
@@ -334,10 +337,16 @@ void
 meta_workspace_remove_window (MetaWorkspace *workspace,
                               MetaWindow    *window)
 {
+  GList *link;
+
   workspace->windows = g_list_remove (workspace->windows, window);
 
-  workspace->mru_list = g_list_remove (workspace->mru_list, window);
-  g_assert (g_list_find (workspace->mru_list, window) == NULL);
+  link = g_hash_table_lookup (workspace->mru_links, window);
+  if (link)
+    {
+      g_queue_delete_link (&workspace->mru_list, link);
+      g_hash_table_remove (workspace->mru_links, window);
+    }
 
   if (window->struts)
     {
@@ -351,6 +360,65 @@ meta_workspace_remove_window (MetaWorkspace *workspace,
   g_object_notify (G_OBJECT (workspace), "n-windows");
 }
 
+void
+meta_workspace_mru_move_to_front (MetaWorkspace *workspace,
+                                  MetaWindow    *window)
+{
+  GList *link;
+
+  link = g_hash_table_lookup (workspace->mru_links, window);
+  g_assert (link);
+
+  g_queue_unlink (&workspace->mru_list, link);
+  g_queue_push_head_link (&workspace->mru_list, link);
+}
+
+void
+meta_workspace_mru_move_to_back (MetaWorkspace *workspace,
+                                 MetaWindow    *window)
+{
+  GList *link;
+
+  link = g_hash_table_lookup (workspace->mru_links, window);
+  g_assert (link);
+
+  g_queue_unlink (&workspace->mru_list, link);
+  g_queue_push_tail_link (&workspace->mru_list, link);
+}
+
+/* Makes sure that window appears after after_this_one in the MRU list,
+ * i.e. treats window as having been less recently used. The windows of
+ * interest are usually at the front of the list, so finding out which
+ * of the two comes first is cheap.
+ */
+void
+meta_workspace_mru_place_after (MetaWorkspace *workspace,
+                                MetaWindow    *window,
+                                MetaWindow    *after_this_one)
+{
+  GList *window_link;
+  GList *after_link;
+  GList *l;
+
+  window_link = g_hash_table_lookup (workspace->mru_links, window);
+  after_link = g_hash_table_lookup (workspace->mru_links, after_this_one);
+
+  if (window_link == NULL || after_link == NULL)
+    return;
+
+  for (l = workspace->mru_list.head; l != NULL; l = l->next)
+    {
+      if (l == after_link)
+        return;
+      if (l == window_link)
+        break;
+    }
+
+  g_queue_delete_link (&workspace->mru_list, window_link);
+  g_queue_insert_after (&workspace->mru_list, after_link, window);
+  g_hash_table_insert (workspace->mru_links, window, after_link->next);
+}
+
 void
 meta_workspace_relocate_windows (MetaWorkspace *workspace,
                                  MetaWorkspace *new_home)
@@ -362,6 +430,8 @@ meta_workspace_relocate_windows (MetaWorkspace *workspace,
   /* can't modify list we're iterating over */
   copy = g_list_copy (workspace->windows);
 
+  meta_screen_freeze_workspaces (workspace->screen);
+
   for (l = copy; l != NULL; l = l->next)
     {
       MetaWindow *window = l->data;
@@ -370,6 +440,8 @@ meta_workspace_relocate_windows (MetaWorkspace *workspace,
         meta_window_change_workspace (window, new_home);
     }
 
+  meta_screen_thaw_workspaces (workspace->screen);
+
   g_list_free (copy);
 
   assert_workspace_empty (workspace);
@@ -655,24 +727,19 @@ meta_workspace_index_changed (MetaWorkspace *workspace)
 GList*
 meta_workspace_list_windows (MetaWorkspace *workspace)
 {
-  GSList *display_windows, *l;
-  GList *workspace_windows;
-
-  display_windows = meta_display_list_windows (workspace->screen->display,
-                                               META_LIST_DEFAULT);
+  GList *workspace_windows, *l;
 
+  /* Sticky windows are in the windows list of every workspace */
   workspace_windows = NULL;
-  for (l = display_windows; l != NULL; l = l->next)
+  for (l = workspace->windows; l != NULL; l = l->next)
     {
       MetaWindow *window = l->data;
 
-      if (meta_window_located_on_workspace (window, workspace))
+      if (!window->override_redirect && !window->unmanaging)
         workspace_windows = g_list_prepend (workspace_windows,
                                             window);
     }
 
-  g_slist_free (display_windows);
-
   return workspace_windows;
 }
 
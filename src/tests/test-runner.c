@@ -22,7 +22,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <meta/display.h>
 #include <meta/main.h>
+#include <meta/meta-backend.h>
 #include <meta/util.h>
 #include <meta/window.h>
 #include <ui/ui.h>
@@ -407,12 +409,60 @@ test_client_alarm_filter (TestClient            *client,
 
 /**********************************************************************/
 
+typedef struct {
+  char *name;
+  GArray *samples; /* gint64, microseconds */
+  gint64 start_time; /* for mark_start/mark_end, or 0 */
+} Measurement;
+
+static Measurement *
+measurement_new (const char *name)
+{
+  Measurement *measurement = g_new0 (Measurement, 1);
+
+  measurement->name = g_strdup (name);
+  measurement->samples = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  return measurement;
+}
+
+static void
+measurement_free (Measurement *measurement)
+{
+  g_free (measurement->name);
+  g_array_free (measurement->samples, TRUE);
+  g_free (measurement);
+}
+
+static int
+compare_samples (gconstpointer a,
+                 gconstpointer b)
+{
+  gint64 sample_a = *(const gint64 *)a;
+  gint64 sample_b = *(const gint64 *)b;
+
+  return sample_a < sample_b ? -1 : (sample_a > sample_b ? 1 : 0);
+}
+
+/* Nearest-rank percentile; the samples must be sorted */
+static gint64
+measurement_percentile (Measurement *measurement,
+                        int          percentile)
+{
+  guint n = measurement->samples->len;
+  guint rank = (n * percentile + 99) / 100;
+
+  return g_array_index (measurement->samples, gint64, MAX (rank, 1) - 1);
+}
+
 typedef struct {
   GHashTable *clients;
   AsyncWaiter *waiter;
   guint log_handler_id;
   GString *warning_messages;
   GMainLoop *loop;
+  GPtrArray *measurements;
+  GRand *rand;
 } TestCase;
 
 static gboolean
@@ -484,6 +534,9 @@ test_case_new (void)
   test->clients = g_hash_table_new (g_str_hash, g_str_equal);
   test->waiter = async_waiter_new ();
   test->loop = g_main_loop_new (NULL, FALSE);
+  test->measurements = g_ptr_array_new_with_free_func ((GDestroyNotify) measurement_free);
+  /* A fixed seed, so that random operations are the same from run to run */
+  test->rand = g_rand_new_with_seed (0);
 
   return test;
 }
@@ -649,6 +702,29 @@ test_case_assert_stacking (TestCase *test,
   return *error == NULL;
 }
 
+static gboolean
+test_case_assert_focused (TestCase    *test,
+                          const char  *expected_window,
+                          GError     **error)
+{
+  MetaDisplay *display = meta_get_display ();
+  const char *focused;
+
+  if (display->focus_window == NULL)
+    focused = "none";
+  else if (g_str_has_prefix (display->focus_window->title, "test/"))
+    focused = display->focus_window->title + 5;
+  else
+    focused = display->focus_window->title;
+
+  if (g_strcmp0 (focused, expected_window) != 0)
+    g_set_error (error, TEST_RUNNER_ERROR, TEST_RUNNER_ERROR_ASSERTION_FAILED,
+                 "focus: expected='%s', actual='%s'",
+                 expected_window, focused);
+
+  return *error == NULL;
+}
+
 static gboolean
 test_case_check_xserver_stacking (TestCase *test,
                                   GError  **error)
@@ -702,6 +778,105 @@ test_case_check_xserver_stacking (TestCase *test,
   return *error == NULL;
 }
 
+static Measurement *
+test_case_lookup_measurement (TestCase   *test,
+                              const char *name)
+{
+  Measurement *measurement;
+  guint i;
+
+  for (i = 0; i < test->measurements->len; i++)
+    {
+      measurement = g_ptr_array_index (test->measurements, i);
+      if (strcmp (measurement->name, name) == 0)
+        return measurement;
+    }
+
+  measurement = measurement_new (name);
+  g_ptr_array_add (test->measurements, measurement);
+
+  return measurement;
+}
+
+/* Replaces each {i} in the arguments with the iteration number */
+static char **
+substitute_iteration (int    argc,
+                      char **argv,
+                      int    iteration)
+{
+  char **result = g_new0 (char *, argc + 1);
+  char *number = g_strdup_printf ("%d", iteration);
+  int i;
+
+  for (i = 0; i < argc; i++)
+    {
+      char **pieces = g_strsplit (argv[i], "{i}", -1);
+      result[i] = g_strjoinv (number, pieces);
+      g_strfreev (pieces);
+    }
+
+  g_free (number);
+
+  return result;
+}
+
+static gboolean
+test_case_restack_storm (TestCase  *test,
+                         int        count,
+                         char     **client_ids,
+                         int        n_client_ids,
+                         GError   **error)
+{
+  MetaDisplay *display = meta_get_display ();
+  GPtrArray *windows = g_ptr_array_new ();
+  GSList *all_windows, *l;
+  int i;
+
+  all_windows = meta_display_list_windows (display, META_LIST_DEFAULT);
+
+  for (i = 0; i < n_client_ids; i++)
+    {
+      TestClient *client = test_case_lookup_client (test, client_ids[i], error);
+      if (!client)
+        goto out;
+
+      char *title_prefix = g_strdup_printf ("test/%s/", client->id);
+
+      for (l = all_windows; l; l = l->next)
+        {
+          MetaWindow *window = l->data;
+          if (window->title && g_str_has_prefix (window->title, title_prefix))
+            g_ptr_array_add (windows, window);
+        }
+
+      g_free (title_prefix);
+    }
+
+  if (windows->len == 0)
+    {
+      g_set_error (error, TEST_RUNNER_ERROR, TEST_RUNNER_ERROR_RUNTIME_ERROR,
+                   "no windows to restack");
+      goto out;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      MetaWindow *window = g_ptr_array_index (windows,
+                                              g_rand_int_range (test->rand, 0, windows->len));
+
+      if (g_rand_boolean (test->rand))
+        meta_window_raise (window);
+      else
+        meta_window_lower (window);
+    }
+
+ out:
+  g_slist_free (all_windows);
+  g_ptr_array_free (windows, TRUE);
+
+  return *error == NULL;
+}
+
 static gboolean
 test_case_do (TestCase *test,
               int       argc,
@@ -819,6 +994,128 @@ test_case_do (TestCase *test,
       if (!test_case_check_xserver_stacking (test, error))
         return FALSE;
     }
+  else if (strcmp (argv[0], "assert_focused") == 0)
+    {
+      if (argc != 2)
+        BAD_COMMAND("usage: %s <client-id>/<window-id>|none", argv[0]);
+
+      if (!test_case_assert_focused (test, argv[1], error))
+        return FALSE;
+    }
+  else if (strcmp (argv[0], "repeat") == 0)
+    {
+      int count, i;
+
+      if (argc < 3 || (count = atoi (argv[1])) <= 0)
+        BAD_COMMAND("usage: %s <count> <command> [<argument>...]", argv[0]);
+
+      for (i = 0; i < count; i++)
+        {
+          char **command = substitute_iteration (argc - 2, argv + 2, i);
+          gboolean success = test_case_do (test, argc - 2, command, error);
+
+          g_strfreev (command);
+          if (!success)
+            return FALSE;
+        }
+    }
+  else if (strcmp (argv[0], "measure") == 0 ||
+           strcmp (argv[0], "measure_local") == 0)
+    {
+      Measurement *measurement;
+      gboolean wait = strcmp (argv[0], "measure") == 0;
+      int count, i;
+
+      if (argc < 4 || (count = atoi (argv[2])) <= 0)
+        BAD_COMMAND("usage: %s <name> <count> <command> [<argument>...]", argv[0]);
+
+      measurement = test_case_lookup_measurement (test, argv[1]);
+
+      for (i = 0; i < count; i++)
+        {
+          char **command = substitute_iteration (argc - 3, argv + 3, i);
+          gint64 start_time = g_get_monotonic_time ();
+          gboolean success = (test_case_do (test, argc - 3, command, error) &&
+                              (!wait || test_case_wait (test, error)));
+          gint64 elapsed = g_get_monotonic_time () - start_time;
+
+          g_strfreev (command);
+          if (!success)
+            return FALSE;
+
+          g_array_append_val (measurement->samples, elapsed);
+        }
+    }
+  else if (strcmp (argv[0], "pick") == 0)
+    {
+      if (argc != 2)
+        BAD_COMMAND("usage: %s <client-id>/<window-id>", argv[0]);
+
+      TestClient *client;
+      const char *window_id;
+      if (!test_case_parse_window_id (test, argv[1], &client, &window_id, error))
+        return FALSE;
+
+      MetaWindow *window = test_client_find_window (client, window_id, error);
+      if (!window)
+        return FALSE;
+
+      MetaRectangle rect;
+      meta_window_get_frame_rect (window, &rect);
+
+      ClutterActor *stage = meta_backend_get_stage (meta_get_backend ());
+      clutter_stage_get_actor_at_pos (CLUTTER_STAGE (stage), CLUTTER_PICK_REACTIVE,
+                                      rect.x + rect.width / 2,
+                                      rect.y + rect.height / 2);
+    }
+  else if (strcmp (argv[0], "tab_list") == 0)
+    {
+      if (argc != 1)
+        BAD_COMMAND("usage: %s", argv[0]);
+
+      MetaDisplay *display = meta_get_display ();
+      MetaWorkspace *workspace = meta_screen_get_active_workspace (display->screen);
+      GList *tab_list = meta_display_get_tab_list (display, META_TAB_LIST_NORMAL, workspace);
+
+      g_list_free (tab_list);
+    }
+  else if (strcmp (argv[0], "mark_start") == 0)
+    {
+      if (argc != 2)
+        BAD_COMMAND("usage: %s <name>", argv[0]);
+
+      Measurement *measurement = test_case_lookup_measurement (test, argv[1]);
+      if (measurement->start_time != 0)
+        BAD_COMMAND("mark_start %s without mark_end", argv[1]);
+
+      measurement->start_time = g_get_monotonic_time ();
+    }
+  else if (strcmp (argv[0], "mark_end") == 0)
+    {
+      if (argc != 2)
+        BAD_COMMAND("usage: %s <name>", argv[0]);
+
+      Measurement *measurement = test_case_lookup_measurement (test, argv[1]);
+      if (measurement->start_time == 0)
+        BAD_COMMAND("mark_end %s without mark_start", argv[1]);
+
+      if (!test_case_wait (test, error))
+        return FALSE;
+
+      gint64 elapsed = g_get_monotonic_time () - measurement->start_time;
+      g_array_append_val (measurement->samples, elapsed);
+      measurement->start_time = 0;
+    }
+  else if (strcmp (argv[0], "restack_storm") == 0)
+    {
+      int count;
+
+      if (argc < 3 || (count = atoi (argv[1])) <= 0)
+        BAD_COMMAND("usage: %s <count> <client-id> [<client-id>...]", argv[0]);
+
+      if (!test_case_restack_storm (test, count, argv + 2, argc - 2, error))
+        return FALSE;
+    }
   else
     {
       BAD_COMMAND("Unknown command %s", argv[0]);
@@ -864,6 +1161,8 @@ test_case_destroy (TestCase *test,
   meta_display_set_alarm_filter (meta_get_display (), NULL, NULL);
 
   g_hash_table_destroy (test->clients);
+  g_ptr_array_unref (test->measurements);
+  g_rand_free (test->rand);
   g_free (test);
 
   g_log_remove_handler ("mutter", test->log_handler_id);
@@ -873,11 +1172,100 @@ test_case_destroy (TestCase *test,
 
 /**********************************************************************/
 
+static char *perf_output = NULL;
+static GString *perf_results = NULL;
+
+/* Appends @str as a quoted JSON string. UTF-8 is passed through, control
+ * characters become \uXXXX escapes and invalid bytes become U+FFFD.
+ */
+static void
+append_json_string (GString    *string,
+                    const char *str)
+{
+  const char *p = str;
+  const char *end = str + strlen (str);
+
+  g_string_append_c (string, '"');
+
+  while (p < end)
+    {
+      const char *valid_end;
+
+      g_utf8_validate (p, end - p, &valid_end);
+
+      for (; p < valid_end; p++)
+        {
+          guchar c = *p;
+
+          if (c == '"' || c == '\\')
+            g_string_append_printf (string, "\\%c", c);
+          else if (c < 0x20 || c == 0x7f)
+            g_string_append_printf (string, "\\u%04x", c);
+          else
+            g_string_append_c (string, c);
+        }
+
+      if (p < end)
+        {
+          g_string_append (string, "\\ufffd");
+          p++;
+        }
+    }
+
+  g_string_append_c (string, '"');
+}
+
+/* Measurements are reported as TAP diagnostics, and if --perf-output was
+ * given, also collected as one JSON object per line.
+ */
+static void
+report_measurements (const char *test_name,
+                     GPtrArray  *measurements)
+{
+  guint i;
+
+  for (i = 0; i < measurements->len; i++)
+    {
+      Measurement *measurement = g_ptr_array_index (measurements, i);
+      guint n = measurement->samples->len;
+
+      if (n == 0)
+        continue;
+
+      g_array_sort (measurement->samples, compare_samples);
+
+      gint64 min = g_array_index (measurement->samples, gint64, 0);
+      gint64 p50 = measurement_percentile (measurement, 50);
+      gint64 p90 = measurement_percentile (measurement, 90);
+      gint64 p99 = measurement_percentile (measurement, 99);
+      gint64 max = g_array_index (measurement->samples, gint64, n - 1);
+
+      g_print ("# perf %s %s: n=%u min=%" G_GINT64_FORMAT "us p50=%" G_GINT64_FORMAT "us "
+               "p90=%" G_GINT64_FORMAT "us p99=%" G_GINT64_FORMAT "us max=%" G_GINT64_FORMAT "us\n",
+               test_name, measurement->name, n, min, p50, p90, p99, max);
+
+      if (perf_results)
+        {
+          g_string_append (perf_results, "{\"test\": ");
+          append_json_string (perf_results, test_name);
+          g_string_append (perf_results, ", \"measure\": ");
+          append_json_string (perf_results, measurement->name);
+          g_string_append_printf (perf_results,
+                                  ", \"samples\": %u, "
+                                  "\"min_us\": %" G_GINT64_FORMAT ", \"p50_us\": %" G_GINT64_FORMAT ", "
+                                  "\"p90_us\": %" G_GINT64_FORMAT ", \"p99_us\": %" G_GINT64_FORMAT ", "
+                                  "\"max_us\": %" G_GINT64_FORMAT "}\n",
+                                  n, min, p50, p90, p99, max);
+        }
+    }
+}
+
 static gboolean
 run_test (const char *filename,
           int         index)
 {
   TestCase *test = test_case_new ();
+  GPtrArray *measurements = g_ptr_array_ref (test->measurements);
   GError *error = NULL;
 
   GFile *file = g_file_new_for_path (filename);
@@ -968,6 +1356,9 @@ run_test (const char *filename,
       g_print ("ok %d %s\n", index, pretty_name);
     }
 
+  report_measurements (pretty_name, measurements);
+  g_ptr_array_unref (measurements);
+
   g_free (pretty_name);
 
   gboolean success = error == NULL;
@@ -996,6 +1387,21 @@ run_tests (gpointer data)
     if (!run_test (info->tests[i], i + 1))
       success = FALSE;
 
+  if (perf_results)
+    {
+      GError *error = NULL;
+
+      if (!g_file_set_contents (perf_output, perf_results->str, perf_results->len, &error))
+        {
+          g_printerr ("Error writing %s: %s\n", perf_output, error->message);
+          g_error_free (error);
+          success = FALSE;
+        }
+
+      g_string_free (perf_results, TRUE);
+      perf_results = NULL;
+    }
+
   meta_quit (success ? 0 : 1);
 
   return FALSE;
@@ -1066,6 +1472,12 @@ const GOptionEntry options[] = {
     "Run all installed tests",
     NULL
   },
+  {
+    "perf-output", 0, 0, G_OPTION_ARG_FILENAME,
+    &perf_output,
+    "Write the results of measurements to FILE, as one JSON object per line",
+    "FILE"
+  },
   { NULL }
 };
 
@@ -1089,6 +1501,9 @@ main (int argc, char **argv)
 
   g_option_context_free (ctx);
 
+  if (perf_output)
+    perf_results = g_string_new (NULL);
+
   GPtrArray *tests = g_ptr_array_new ();
 
   if (all_tests)
@@ -30,6 +30,7 @@
 #include "core.h"
 #include <meta/theme.h>
 #include <meta/prefs.h>
+#include "core/prefs-private.h"
 #include "ui.h"
 
 #include "core/window-private.h"
@@ -129,20 +130,14 @@ unsigned_long_hash (gconstpointer v)
 }
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        void          *data)
+prefs_changed_callback (MetaPrefsChangeSet  changes,
+                        void               *data)
 {
-  switch (pref)
-    {
-    case META_PREF_TITLEBAR_FONT:
-      meta_frames_font_changed (META_FRAMES (data));
-      break;
-    case META_PREF_BUTTON_LAYOUT:
-      meta_frames_button_layout_changed (META_FRAMES (data));
-      break;
-    default:
-      break;
-    }
+  /* A font change already redraws every frame */
+  if (META_PREFS_CHANGE_SET_HAS (changes, META_PREF_TITLEBAR_FONT))
+    meta_frames_font_changed (META_FRAMES (data));
+  else if (META_PREFS_CHANGE_SET_HAS (changes, META_PREF_BUTTON_LAYOUT))
+    meta_frames_button_layout_changed (META_FRAMES (data));
 }
 
 static void
@@ -151,6 +146,37 @@ invalidate_whole_window (MetaUIFrame *frame)
   gdk_window_invalidate_rect (frame->window, NULL, FALSE);
 }
 
+/* Title changes only affect the title text, so avoid repainting the
+ * borders and buttons; GDK coalesces the invalidation with anything
+ * else pending, so a client spamming title updates costs at most one
+ * titlebar repaint per frame.
+ */
+static void
+invalidate_title (MetaUIFrame *frame)
+{
+  MetaFrameGeometry fgeom;
+  GdkRectangle rect;
+
+  meta_ui_frame_calc_geometry (frame, &fgeom);
+
+  rect.x = fgeom.title_rect.x;
+  rect.y = 0;
+  rect.width = fgeom.title_rect.width;
+  rect.height = fgeom.borders.total.top;
+
+  gdk_window_invalidate_rect (frame->window, &rect, FALSE);
+}
+
+static void
+update_title_width (MetaUIFrame *frame)
+{
+  PangoRectangle logical;
+
+  pango_layout_set_width (frame->text_layout, -1);
+  pango_layout_get_pixel_extents (frame->text_layout, NULL, &logical);
+  frame->title_width = logical.width;
+}
+
 static MetaStyleInfo *
 meta_frames_get_theme_variant (MetaFrames  *frames,
                                const gchar *variant)
@@ -193,7 +219,10 @@ update_style_contexts (MetaFrames *frames)
 static void
 meta_frames_init (MetaFrames *frames)
 {
-  frames->text_heights = g_hash_table_new (NULL, NULL);
+  frames->text_heights = g_hash_table_new_full ((GHashFunc) pango_font_description_hash,
+                                                (GEqualFunc) pango_font_description_equal,
+                                                (GDestroyNotify) pango_font_description_free,
+                                                NULL);
 
   frames->frames = g_hash_table_new (unsigned_long_hash, unsigned_long_equal);
 
@@ -202,7 +231,7 @@ meta_frames_init (MetaFrames *frames)
 
   update_style_contexts (frames);
 
-  meta_prefs_add_listener (prefs_changed_callback, frames);
+  meta_prefs_add_batch_listener (prefs_changed_callback, frames);
 }
 
 static void
@@ -256,7 +285,7 @@ meta_frames_finalize (GObject *object)
 
   frames = META_FRAMES (object);
 
-  meta_prefs_remove_listener (prefs_changed_callback, frames);
+  meta_prefs_remove_batch_listener (prefs_changed_callback, frames);
 
   g_hash_table_destroy (frames->text_heights);
 
@@ -281,11 +310,7 @@ queue_recalc_func (gpointer key, gpointer value, gpointer data)
 static void
 meta_frames_font_changed (MetaFrames *frames)
 {
-  if (g_hash_table_size (frames->text_heights) > 0)
-    {
-      g_hash_table_destroy (frames->text_heights);
-      frames->text_heights = g_hash_table_new (NULL, NULL);
-    }
+  g_hash_table_remove_all (frames->text_heights);
 
   /* Queue a draw/resize on all frames */
   g_hash_table_foreach (frames->frames,
@@ -353,9 +378,8 @@ meta_ui_frame_ensure_layout (MetaUIFrame    *frame,
 
   if (frame->text_layout == NULL)
     {
-      gpointer key, value;
+      gpointer value;
       PangoFontDescription *font_desc;
-      int size;
 
       frame->text_layout = gtk_widget_create_pango_layout (widget, frame->title);
 
@@ -366,13 +390,17 @@ meta_ui_frame_ensure_layout (MetaUIFrame    *frame,
       font_desc = meta_style_info_create_font_desc (frame->style_info);
       meta_frame_layout_apply_scale (layout, font_desc);
 
-      size = pango_font_description_get_size (font_desc);
-
+      /* The font description already has the scale applied, so it
+       * identifies the text metrics completely; frames sharing a style
+       * only ever query the font metrics once.
+       */
       if (g_hash_table_lookup_extended (frames->text_heights,
-                                        GINT_TO_POINTER (size),
-                                        &key, &value))
+                                        font_desc, NULL, &value))
         {
           frame->text_height = GPOINTER_TO_INT (value);
+          pango_layout_set_font_description (frame->text_layout,
+                                             font_desc);
+          pango_font_description_free (font_desc);
         }
       else
         {
@@ -380,15 +408,15 @@ meta_ui_frame_ensure_layout (MetaUIFrame    *frame,
             meta_pango_font_desc_get_text_height (font_desc,
                                                   gtk_widget_get_pango_context (widget));
 
-          g_hash_table_replace (frames->text_heights,
-                                GINT_TO_POINTER (size),
-                                GINT_TO_POINTER (frame->text_height));
-        }
+          pango_layout_set_font_description (frame->text_layout,
+                                             font_desc);
 
-      pango_layout_set_font_description (frame->text_layout,
-                                         font_desc);
+          g_hash_table_insert (frames->text_heights,
+                               font_desc,
+                               GINT_TO_POINTER (frame->text_height));
+        }
 
-      pango_font_description_free (font_desc);
+      update_title_width (frame);
     }
 }
 
@@ -519,6 +547,7 @@ meta_frames_manage_window (MetaFrames *frames,
   frame->cache_layout = NULL;
   frame->text_layout = NULL;
   frame->text_height = -1;
+  frame->title_width = 0;
   frame->title = NULL;
   frame->prelit_control = META_FRAME_CONTROL_NONE;
   frame->button_state = META_BUTTON_STATE_NORMAL;
@@ -734,12 +763,25 @@ void
 meta_ui_frame_set_title (MetaUIFrame *frame,
                          const char *title)
 {
+  if (g_strcmp0 (frame->title, title) == 0)
+    return;
+
   g_free (frame->title);
   frame->title = g_strdup (title);
 
-  g_clear_object (&frame->text_layout);
+  /* The font and therefore the frame size don't depend on the title,
+   * so keep the existing layout and only swap the text.
+   */
+  if (frame->text_layout == NULL)
+    {
+      invalidate_whole_window (frame);
+      return;
+    }
 
-  invalidate_whole_window (frame);
+  pango_layout_set_text (frame->text_layout, frame->title ? frame->title : "", -1);
+  update_title_width (frame);
+
+  invalidate_title (frame);
 }
 
 void
@@ -1531,6 +1573,7 @@ meta_ui_frame_paint (MetaUIFrame  *frame,
                          priv->client_rect.width,
                          priv->client_rect.height,
                          frame->text_layout,
+                         frame->title_width,
                          frame->text_height,
                          &button_layout,
                          button_states,
@@ -80,7 +80,8 @@ struct _MetaUIFrame
   MetaFrameLayout *cache_layout;
   PangoLayout *text_layout;
   int text_height;
-  char *title; /* NULL once we have a layout */
+  int title_width; /* natural width of text_layout, before ellipsizing */
+  char *title; /* kept for the frame lifetime, text of text_layout */
   guint maybe_ignore_leave_notify : 1;
 
   /* FIXME get rid of this, it can just be in the MetaFrames struct */
@@ -250,6 +250,7 @@ void meta_theme_draw_frame (MetaTheme              *theme,
                             int                     client_width,
                             int                     client_height,
                             PangoLayout            *title_layout,
+                            int                     title_width,
                             int                     text_height,
                             const MetaButtonLayout *button_layout,
                             MetaButtonState         button_states[META_BUTTON_TYPE_LAST],
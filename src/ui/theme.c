@@ -712,6 +712,7 @@ meta_frame_layout_draw_with_style (MetaFrameLayout         *layout,
                                    cairo_t                 *cr,
                                    const MetaFrameGeometry *fgeom,
                                    PangoLayout             *title_layout,
+                                   int                      title_width,
                                    MetaFrameFlags           flags,
                                    MetaButtonState          button_states[META_BUTTON_TYPE_LAST],
                                    cairo_surface_t         *mini_icon)
@@ -773,13 +774,19 @@ meta_frame_layout_draw_with_style (MetaFrameLayout         *layout,
       PangoRectangle logical;
       int text_width, x, y;
 
-      pango_layout_set_width (title_layout, -1);
-      pango_layout_get_pixel_extents (title_layout, NULL, &logical);
-
-      text_width = MIN(fgeom->title_rect.width / scale, logical.width);
+      /* title_width is the natural width of the title, cached by the
+       * caller; only touching the layout width when the ellipsized width
+       * actually changes keeps pango from re-laying out the text on
+       * every repaint.
+       */
+      text_width = MIN(fgeom->title_rect.width / scale, title_width);
 
-      if (text_width < logical.width)
+      if (text_width < title_width)
         pango_layout_set_width (title_layout, PANGO_SCALE * text_width);
+      else
+        pango_layout_set_width (title_layout, -1);
+
+      pango_layout_get_pixel_extents (title_layout, NULL, &logical);
 
       /* Center within the frame if possible */
       x = titlebar_rect.x + (titlebar_rect.width - text_width) / 2;
@@ -1191,6 +1198,7 @@ meta_theme_draw_frame (MetaTheme              *theme,
                        int                     client_width,
                        int                     client_height,
                        PangoLayout            *title_layout,
+                       int                     title_width,
                        int                     text_height,
                        const MetaButtonLayout *button_layout,
                        MetaButtonState         button_states[META_BUTTON_TYPE_LAST],
@@ -1222,6 +1230,7 @@ meta_theme_draw_frame (MetaTheme              *theme,
                                      cr,
                                      &fgeom,
                                      title_layout,
+                                     title_width,
                                      flags,
                                      button_states,
                                      mini_icon);
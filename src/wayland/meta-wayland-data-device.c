@@ -208,6 +208,30 @@ meta_wayland_data_source_send_offer (MetaWaylandDataSource *source,
   return offer->resource;
 }
 
+static void
+send_selection (MetaWaylandDataDevice *data_device,
+                struct wl_resource    *data_device_resource)
+{
+  MetaWaylandDataSource *source = data_device->selection_data_source;
+  struct wl_resource *offer = NULL;
+
+  /* Clients expect a selection event before every keyboard enter, even
+   * if focus comes back to them; they may have dropped the previous
+   * offer when they lost focus, so always send a new one.
+   */
+  if (source)
+    {
+      offer = meta_wayland_data_source_send_offer (source, data_device_resource);
+      data_device->n_selection_offers++;
+
+      meta_verbose ("Offered selection to client %p (%u offers sent)\n",
+                    wl_resource_get_client (data_device_resource),
+                    data_device->n_selection_offers);
+    }
+
+  wl_data_device_send_selection (data_device_resource, offer);
+}
+
 static void
 data_source_offer (struct wl_client *client,
                    struct wl_resource *resource, const char *type)
@@ -564,7 +588,7 @@ selection_data_source_destroyed (gpointer data, GObject *object_was_here)
     {
       data_device_resource = wl_resource_find_for_client (&data_device->resource_list, focus_client);
       if (data_device_resource)
-        wl_data_device_send_selection (data_device_resource, NULL);
+        send_selection (data_device, data_device_resource);
     }
 }
 
@@ -758,7 +782,7 @@ meta_wayland_data_device_set_selection (MetaWaylandDataDevice *data_device,
                                         guint32 serial)
 {
   MetaWaylandSeat *seat = wl_container_of (data_device, seat, data_device);
-  struct wl_resource *data_device_resource, *offer;
+  struct wl_resource *data_device_resource;
   struct wl_client *focus_client;
 
   if (data_device->selection_data_source &&
@@ -782,17 +806,7 @@ meta_wayland_data_device_set_selection (MetaWaylandDataDevice *data_device,
     {
       data_device_resource = wl_resource_find_for_client (&data_device->resource_list, focus_client);
       if (data_device_resource)
-        {
-          if (data_device->selection_data_source)
-            {
-              offer = meta_wayland_data_source_send_offer (data_device->selection_data_source, data_device_resource);
-              wl_data_device_send_selection (data_device_resource, offer);
-            }
-          else
-            {
-              wl_data_device_send_selection (data_device_resource, NULL);
-            }
-        }
+        send_selection (data_device, data_device_resource);
     }
 
   if (source)
@@ -905,8 +919,7 @@ meta_wayland_data_device_set_keyboard_focus (MetaWaylandDataDevice *data_device)
 {
   MetaWaylandSeat *seat = wl_container_of (data_device, seat, data_device);
   struct wl_client *focus_client;
-  struct wl_resource *data_device_resource, *offer;
-  MetaWaylandDataSource *source;
+  struct wl_resource *data_device_resource;
 
   focus_client = meta_wayland_keyboard_get_focus_client (&seat->keyboard);
   if (!focus_client)
@@ -916,14 +929,7 @@ meta_wayland_data_device_set_keyboard_focus (MetaWaylandDataDevice *data_device)
   if (!data_device_resource)
     return;
 
-  source = data_device->selection_data_source;
-  if (source)
-    {
-      offer = meta_wayland_data_source_send_offer (source, data_device_resource);
-      wl_data_device_send_selection (data_device_resource, offer);
-    }
-  else
-    wl_data_device_send_selection (data_device_resource, NULL);
+  send_selection (data_device, data_device_resource);
 }
 
 gboolean
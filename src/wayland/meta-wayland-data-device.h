@@ -56,6 +56,8 @@ struct _MetaWaylandDataDevice
   struct wl_list resource_list;
   MetaWaylandDragGrab *current_grab;
 
+  guint n_selection_offers;
+
   struct wl_signal selection_ownership_signal;
   struct wl_signal dnd_ownership_signal;
 };
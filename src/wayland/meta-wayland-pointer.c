@@ -132,15 +132,29 @@ meta_wayland_pointer_send_motion (MetaWaylandPointer *pointer,
 {
   struct wl_resource *resource;
   struct wl_list *l;
+  wl_fixed_t sx, sy;
 
   l = &pointer->focus_resource_list;
+  if (wl_list_empty (l))
+    return;
+
+  meta_wayland_pointer_get_relative_coordinates (pointer,
+                                                 pointer->focus_surface,
+                                                 &sx, &sy);
+
+  /* Motion that doesn't move the pointer within the surface, e.g. when
+   * held against a barrier or moving by less than the fixed point
+   * precision, tells the client nothing new. */
+  if (pointer->has_last_motion &&
+      sx == pointer->last_motion_x && sy == pointer->last_motion_y)
+    return;
+
+  pointer->has_last_motion = TRUE;
+  pointer->last_motion_x = sx;
+  pointer->last_motion_y = sy;
+
   wl_resource_for_each(resource, l)
     {
-      wl_fixed_t sx, sy;
-
-      meta_wayland_pointer_get_relative_coordinates (pointer,
-                                                     pointer->focus_surface,
-                                                     &sx, &sy);
       wl_pointer_send_motion (resource, clutter_event_get_time (event), sx, sy);
     }
 }
@@ -295,6 +309,7 @@ repick_for_event (MetaWaylandPointer *pointer,
                   const ClutterEvent *for_event)
 {
   ClutterActor *actor;
+  MetaWaylandSurface *surface;
 
   if (for_event)
     actor = clutter_event_get_source (for_event);
@@ -302,9 +317,20 @@ repick_for_event (MetaWaylandPointer *pointer,
     actor = clutter_input_device_get_pointer_actor (pointer->device);
 
   if (META_IS_SURFACE_ACTOR_WAYLAND (actor))
-    pointer->current = meta_surface_actor_wayland_get_surface (META_SURFACE_ACTOR_WAYLAND (actor));
+    surface = meta_surface_actor_wayland_get_surface (META_SURFACE_ACTOR_WAYLAND (actor));
   else
-    pointer->current = NULL;
+    surface = NULL;
+
+  if (surface == pointer->current)
+    {
+      /* Updating the cursor re-imports the cursor buffer, so only do
+       * it when the pointer moved onto another surface; cursor surface
+       * changes are handled where they happen. */
+      sync_focus_surface (pointer);
+      return;
+    }
+
+  pointer->current = surface;
 
   sync_focus_surface (pointer);
   meta_wayland_pointer_update_cursor_surface (pointer);
@@ -504,6 +530,8 @@ meta_wayland_pointer_set_focus (MetaWaylandPointer *pointer,
       pointer->focus_surface = NULL;
     }
 
+  pointer->has_last_motion = FALSE;
+
   if (surface != NULL)
     {
       struct wl_resource *resource;
@@ -56,6 +56,9 @@ struct _MetaWaylandPointer
   guint32 focus_serial;
   guint32 click_serial;
 
+  gboolean has_last_motion;
+  wl_fixed_t last_motion_x, last_motion_y;
+
   MetaCursorTracker *cursor_tracker;
   MetaWaylandSurface *cursor_surface;
   struct wl_listener cursor_surface_destroy_listener;
@@ -40,7 +40,10 @@
 
 GType meta_wayland_data_source_xwayland_get_type (void) G_GNUC_CONST;
 
+/* Wayland to X11 transfers start out with INCR_CHUNK_SIZE chunks, which
+ * double for every full chunk up to what fits in a single X request. */
 #define INCR_CHUNK_SIZE (128 * 1024)
+#define MAX_INCR_CHUNK_SIZE (4 * 1024 * 1024)
 #define XDND_VERSION 5
 
 typedef struct {
@@ -49,7 +52,8 @@ typedef struct {
   GCancellable *cancellable;
   MetaWindow *window;
   XSelectionRequestEvent request_event;
-  guchar buffer[INCR_CHUNK_SIZE];
+  guchar *buffer;
+  gsize buffer_size;
   gsize buffer_len;
   guint incr : 1;
 } WaylandSelectionData;
@@ -59,6 +63,9 @@ typedef struct {
   GOutputStream *stream;
   GCancellable *cancellable;
   gchar *mime_type;
+  guchar *chunk;
+  gsize chunk_len;
+  gsize chunk_written;
   guint incr : 1;
 } X11SelectionData;
 
@@ -66,6 +73,7 @@ typedef struct {
   Atom selection_atom;
   Window window;
   Window owner;
+  Time owner_timestamp;
   Time timestamp;
   MetaWaylandDataSource *source; /* owned by MetaWaylandDataDevice */
   WaylandSelectionData *wayland_selection;
@@ -385,6 +393,7 @@ x11_selection_data_free (X11SelectionData *data)
   g_object_unref (data->cancellable);
   g_object_unref (data->stream);
   g_free (data->mime_type);
+  g_free (data->chunk);
   g_slice_free (X11SelectionData, data);
 }
 
@@ -403,37 +412,75 @@ x11_selection_data_finish (MetaSelectionBridge *selection,
                    (GDestroyNotify) x11_selection_data_free);
 }
 
+static void x11_selection_data_write_chunk (MetaSelectionBridge *selection);
+
 static void
 x11_data_write_cb (GObject      *object,
                    GAsyncResult *res,
                    gpointer      user_data)
 {
   MetaSelectionBridge *selection = user_data;
-  X11SelectionData *data = selection->x11_selection;
+  X11SelectionData *data;
   GError *error = NULL;
+  gssize bytes_written;
 
-  g_output_stream_write_finish (G_OUTPUT_STREAM (object), res, &error);
+  bytes_written = g_output_stream_write_finish (G_OUTPUT_STREAM (object),
+                                                res, &error);
 
-  if (data->incr)
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
-      XDeleteProperty (xdisplay, selection->window,
-                       gdk_x11_get_xatom_by_name ("_META_SELECTION"));
+      /* The transfer data is gone already */
+      g_error_free (error);
+      return;
     }
 
+  data = selection->x11_selection;
+
   if (error)
     {
-      if (error->domain != G_IO_ERROR ||
-          error->code != G_IO_ERROR_CANCELLED)
-        g_warning ("Error writing from X11 selection: %s\n", error->message);
-
+      g_warning ("Error writing from X11 selection: %s\n", error->message);
       g_error_free (error);
+
+      x11_selection_data_finish (selection, FALSE);
+      return;
     }
 
-  if (!data->incr)
+  /* Pipes take partial writes once the reader falls behind */
+  data->chunk_written += bytes_written;
+  if (data->chunk_written < data->chunk_len)
+    {
+      x11_selection_data_write_chunk (selection);
+      return;
+    }
+
+  g_clear_pointer (&data->chunk, g_free);
+  data->chunk_len = data->chunk_written = 0;
+
+  if (data->incr)
+    {
+      Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+
+      /* Only ask for the next chunk once this one is written out, so
+       * a slow reader throttles the X11 owner. */
+      XDeleteProperty (xdisplay, selection->window,
+                       gdk_x11_get_xatom_by_name ("_META_SELECTION"));
+    }
+  else
     x11_selection_data_finish (selection, TRUE);
 }
 
+static void
+x11_selection_data_write_chunk (MetaSelectionBridge *selection)
+{
+  X11SelectionData *data = selection->x11_selection;
+
+  g_output_stream_write_async (data->stream,
+                               data->chunk + data->chunk_written,
+                               data->chunk_len - data->chunk_written,
+                               G_PRIORITY_DEFAULT, data->cancellable,
+                               x11_data_write_cb, selection);
+}
+
 static void
 x11_selection_data_write (MetaSelectionBridge *selection,
                           guchar              *buffer,
@@ -441,9 +488,13 @@ x11_selection_data_write (MetaSelectionBridge *selection,
 {
   X11SelectionData *data = selection->x11_selection;
 
-  g_output_stream_write_async (data->stream, buffer, len,
-                               G_PRIORITY_DEFAULT, data->cancellable,
-                               x11_data_write_cb, selection);
+  /* The property data is freed as soon as we return */
+  g_free (data->chunk);
+  data->chunk = g_memdup (buffer, len);
+  data->chunk_len = len;
+  data->chunk_written = 0;
+
+  x11_selection_data_write_chunk (selection);
 }
 
 static MetaWaylandDataSource *
@@ -505,6 +556,8 @@ wayland_selection_data_new (XSelectionRequestEvent *request_event,
 
   data = g_slice_new0 (WaylandSelectionData);
   data->request_event = *request_event;
+  data->buffer_size = INCR_CHUNK_SIZE;
+  data->buffer = g_malloc (data->buffer_size);
   data->cancellable = g_cancellable_new ();
   data->stream = g_unix_input_stream_new (p[0], TRUE);
 
@@ -558,6 +611,7 @@ wayland_selection_data_free (WaylandSelectionData *data)
   g_cancellable_cancel (data->cancellable);
   g_object_unref (data->cancellable);
   g_object_unref (data->stream);
+  g_free (data->buffer);
   g_slice_free (WaylandSelectionData, data);
 }
 
@@ -575,18 +629,46 @@ wayland_selection_update_x11_property (WaylandSelectionData *data)
   data->buffer_len = 0;
 }
 
+static void wayland_selection_data_read (MetaSelectionBridge *selection);
+
+static gsize
+get_max_incr_chunk_size (void)
+{
+  Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  long max_request_size;
+
+  max_request_size = XExtendedMaxRequestSize (xdisplay);
+  if (max_request_size == 0)
+    max_request_size = XMaxRequestSize (xdisplay);
+
+  /* Request sizes are in 4 byte units, leave room for the
+   * ChangeProperty request header. */
+  return CLAMP ((gsize) max_request_size * 4 - 256,
+                INCR_CHUNK_SIZE, MAX_INCR_CHUNK_SIZE);
+}
+
 static void
 wayland_data_read_cb (GObject      *object,
                       GAsyncResult *res,
                       gpointer      user_data)
 {
   MetaSelectionBridge *selection = user_data;
-  WaylandSelectionData *data = selection->wayland_selection;
+  WaylandSelectionData *data;
   GError *error = NULL;
-  gsize bytes_read;
+  gssize bytes_read;
 
   bytes_read = g_input_stream_read_finish (G_INPUT_STREAM (object),
                                            res, &error);
+
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      /* The transfer data is gone already */
+      g_error_free (error);
+      return;
+    }
+
+  data = selection->wayland_selection;
+
   if (error)
     {
       g_warning ("Error transfering wayland clipboard to X11: %s\n",
@@ -603,14 +685,22 @@ wayland_data_read_cb (GObject      *object,
       return;
     }
 
-  data->buffer_len = bytes_read;
+  data->buffer_len += bytes_read;
 
-  if (bytes_read == INCR_CHUNK_SIZE)
+  /* Reads from the pipe return whatever the client wrote so far, keep
+   * filling the chunk until it's full or the client is done. */
+  if (bytes_read > 0 && data->buffer_len < data->buffer_size)
+    {
+      wayland_selection_data_read (selection);
+      return;
+    }
+
+  if (bytes_read > 0)
     {
       if (!data->incr)
         {
           Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
-          guint32 incr_chunk_size = INCR_CHUNK_SIZE;
+          guint32 incr_chunk_size = data->buffer_size;
 
           /* Not yet in incr */
           data->incr = TRUE;
@@ -635,10 +725,14 @@ wayland_data_read_cb (GObject      *object,
         }
       else if (data->incr)
         {
-          /* Incr transfer complete, setting a new property */
+          gsize remaining = data->buffer_len;
+
+          /* Incr transfer complete, setting a new property. If it had
+           * data, the empty property marking the end follows once the
+           * requestor deleted this one. */
           wayland_selection_update_x11_property (data);
 
-          if (bytes_read > 0)
+          if (remaining > 0)
             return;
         }
 
@@ -652,8 +746,20 @@ wayland_selection_data_read (MetaSelectionBridge *selection)
 {
   WaylandSelectionData *data = selection->wayland_selection;
 
-  g_input_stream_read_async (data->stream, data->buffer,
-                             INCR_CHUNK_SIZE, G_PRIORITY_DEFAULT,
+  /* The previous chunk was full; fewer, larger chunks mean fewer
+   * round trips through the requestor. */
+  if (data->incr && data->buffer_len == 0 &&
+      data->buffer_size < get_max_incr_chunk_size ())
+    {
+      data->buffer_size = MIN (data->buffer_size * 2,
+                               get_max_incr_chunk_size ());
+      data->buffer = g_realloc (data->buffer, data->buffer_size);
+    }
+
+  g_input_stream_read_async (data->stream,
+                             data->buffer + data->buffer_len,
+                             data->buffer_size - data->buffer_len,
+                             G_PRIORITY_DEFAULT,
                              data->cancellable,
                              wayland_data_read_cb, selection);
 }
@@ -1383,7 +1489,15 @@ meta_xwayland_selection_handle_xfixes_selection_notify (MetaWaylandCompositor *c
         }
       else
         {
+          /* Clipboard managers tend to re-announce the same ownership;
+           * the TARGETS we already fetched still apply then. */
+          if (selection->source && selection->owner == event->owner &&
+              selection->owner != selection->window &&
+              selection->owner_timestamp == event->selection_timestamp)
+            return TRUE;
+
           selection->owner = event->owner;
+          selection->owner_timestamp = event->selection_timestamp;
 
           if (selection->owner == selection->window)
             {